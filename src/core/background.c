@@ -13,24 +13,18 @@
 #include "utils/debug.h"
 
 void
-rxi_calc_bgfield (struct rxi_calc_data *data,
-    const struct rxi_db_molecule_radtr *mol_radtr, const int n_radtr)
+rxi_calc_bgfield (struct rxi_calc_data *data)
 {
   DEBUG ("Calculating background field intensity");
 
-  for (int i = 0; i < n_radtr; ++i)
+  const struct rxi_calc_lines *lines = &data->lines;
+  for (size_t i = 0; i < data->numof_radtr; ++i)
     {
-      const unsigned int u = mol_radtr->up[i] - 1;
-      const unsigned int l = mol_radtr->low[i] - 1;
-
-      const double energy = gsl_vector_get (data->term, u)
-                            - gsl_vector_get (data->term, l);
-
       const double intens =
-              (2 * RXI_HP * RXI_SOL * gsl_pow_3 (energy))
+              lines->occ_norm[i]
           / //-------------------------------------------------
-              (exp (RXI_FK * energy / data->input.temp_bg) - 1);
+              (exp (RXI_FK * lines->energy[i] / data->input.temp_bg) - 1);
 
-      gsl_matrix_set (data->bgfield, u, l, intens);
+      gsl_vector_set (data->bgfield, i, intens);
   }
 }
@@ -5,5 +5,6 @@
 
 #include "rxi_common.h"
 
-void rxi_calc_bgfield (struct rxi_calc_data *data,
-    const struct rxi_db_molecule_radtr *mol_radtr, const int n_radtr);
+/// @brief Fills `bgfield` with black body intensities at `temp_bg` for lines
+/// of @p data; `rxi_calc_data_set_temp_bg()` runs it as a setup stage.
+void rxi_calc_bgfield (struct rxi_calc_data *data);
@@ -0,0 +1,518 @@
+/**
+ * @file core/batch.c
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+
+#include "core/batch.h"
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "core/escape_table.h"
+#include "utils/debug.h"
+
+// Loops over lanes run over `w` lanes, a multiple of `RXI_BATCH_STEP`, in
+// groups of fixed size, so that the compiler maps every group to SIMD
+// registers without remainder loops.
+
+// y -= a x in each lane
+static inline void
+lanes_sub_mul (const size_t w, double *restrict y, const double *restrict a,
+               const double *restrict x)
+{
+  for (size_t k = 0; k < w; k += RXI_BATCH_STEP)
+    {
+      for (size_t q = 0; q < RXI_BATCH_STEP; ++q)
+        y[k + q] -= a[k + q] * x[k + q];
+    }
+}
+
+// y /= x in each lane
+static inline void
+lanes_div (const size_t w, double *restrict y, const double *restrict x)
+{
+  for (size_t k = 0; k < w; k += RXI_BATCH_STEP)
+    {
+      for (size_t q = 0; q < RXI_BATCH_STEP; ++q)
+        y[k + q] /= x[k + q];
+    }
+}
+
+// y += x in each lane
+static inline void
+lanes_add (const size_t w, double *restrict y, const double *restrict x)
+{
+  for (size_t k = 0; k < w; k += RXI_BATCH_STEP)
+    {
+      for (size_t q = 0; q < RXI_BATCH_STEP; ++q)
+        y[k + q] += x[k + q];
+    }
+}
+
+// Puts model `data` to lane `k`, starting its iteration from scratch
+static void
+load_lane (struct rxi_calc_batch *batch, const size_t k,
+           struct rxi_calc_data *data)
+{
+  const size_t n = batch->numof_enlev;
+  const size_t lanes = batch->numof_lanes;
+
+  batch->lane_data[k] = data;
+  batch->lane_iter[k] = 0;
+  batch->thick_lines[k] = 1;
+  batch->stop_cond[k] = 0;
+  batch->col_dens[k] = data->input.col_dens;
+  batch->line_width[k] = data->input.line_width;
+  batch->temp_bg[k] = data->input.temp_bg;
+  batch->geom[k] = data->input.geom;
+
+  for (size_t i = 0; i < n; ++i)
+    {
+      for (size_t j = 0; j < n; ++j)
+        {
+          batch->coll[(i * n + j) * lanes + k] =
+              gsl_matrix_get (data->rates_archive, i, j);
+        }
+      batch->pop[i * lanes + k] = 0;
+      batch->prev_pop[i * lanes + k] = 0;
+    }
+
+  for (size_t i = 0; i < batch->numof_radtr; ++i)
+    {
+      batch->bgfield[i * lanes + k] = gsl_vector_get (data->bgfield, i);
+      batch->tau[i * lanes + k] = 0;
+      batch->excit_temp[i * lanes + k] = 0;
+    }
+}
+
+// Moves the state of lane `src` to lane `dst`
+static void
+move_lane (struct rxi_calc_batch *batch, const size_t dst, const size_t src)
+{
+  const size_t n = batch->numof_enlev;
+  const size_t lanes = batch->numof_lanes;
+
+  batch->lane_data[dst] = batch->lane_data[src];
+  batch->lane_iter[dst] = batch->lane_iter[src];
+  batch->thick_lines[dst] = batch->thick_lines[src];
+  batch->stop_cond[dst] = batch->stop_cond[src];
+  batch->col_dens[dst] = batch->col_dens[src];
+  batch->line_width[dst] = batch->line_width[src];
+  batch->temp_bg[dst] = batch->temp_bg[src];
+  batch->geom[dst] = batch->geom[src];
+
+  for (size_t i = 0; i < n * n; ++i)
+    batch->coll[i * lanes + dst] = batch->coll[i * lanes + src];
+
+  for (size_t i = 0; i < n; ++i)
+    {
+      batch->pop[i * lanes + dst] = batch->pop[i * lanes + src];
+      batch->prev_pop[i * lanes + dst] = batch->prev_pop[i * lanes + src];
+    }
+
+  for (size_t i = 0; i < batch->numof_radtr; ++i)
+    {
+      batch->bgfield[i * lanes + dst] = batch->bgfield[i * lanes + src];
+      batch->tau[i * lanes + dst] = batch->tau[i * lanes + src];
+      batch->excit_temp[i * lanes + dst] = batch->excit_temp[i * lanes + src];
+    }
+}
+
+// Escape probabilities for optical depths of all lanes. Lanes usually share
+// the geometry, and all of them are done in one call then; otherwise the
+// call is made for every geometry and each lane takes its own.
+static void
+escape_probs (struct rxi_calc_batch *batch, const size_t w)
+{
+  const size_t lanes = batch->numof_lanes;
+  const size_t size = batch->numof_radtr * lanes;
+  void (*const calc) (const GEOMETRY, const size_t, const double *restrict,
+                      double *restrict)
+    = batch->lane_data[0]->input.solver.escape_table
+        ? rxi_calc_escape_prob_table : rxi_calc_escape_prob_array;
+
+  bool mixed = false;
+  for (size_t k = 1; k < w; ++k)
+    mixed |= (batch->geom[k] != batch->geom[0]);
+
+  if (!mixed)
+    {
+      calc (batch->geom[0], size, batch->tau, batch->beta);
+      return;
+    }
+
+  const GEOMETRY geoms[] = { SPHERE, SLAB, LVG };
+  for (size_t g = 0; g < sizeof (geoms) / sizeof (geoms[0]); ++g)
+    {
+      calc (geoms[g], size, batch->tau, batch->beta_geom);
+      for (size_t i = 0; i < batch->numof_radtr; ++i)
+        {
+          for (size_t k = 0; k < w; ++k)
+            {
+              if (batch->geom[k] == geoms[g])
+                batch->beta[i * lanes + k] = batch->beta_geom[i * lanes + k];
+            }
+        }
+    }
+}
+
+// Builds rate matrices and right-hand sides of the first `w` lanes. Lanes on
+// their first iteration get the optically thin rates of
+// `set_starting_conditions()`, the others those of
+// `refresh_starting_conditions()` for their current populations.
+static void
+assemble_rates (struct rxi_calc_batch *batch, const struct rxi_calc_data *mol,
+                const size_t w)
+{
+  const size_t n = batch->numof_enlev;
+  const size_t lanes = batch->numof_lanes;
+  const struct rxi_calc_lines *lines = &mol->lines;
+  const double *coll = batch->coll;
+  double *rates = batch->rates;
+
+  for (size_t i = 0; i < n * n * lanes; ++i)
+    rates[i] = coll[i];
+
+  for (size_t k = 0; k < w; ++k)
+    {
+      batch->stop_cond[k] = 0;
+      if (batch->lane_iter[k] != 0)
+        batch->thick_lines[k] = 0;
+    }
+
+  for (size_t i = 0; i < batch->numof_radtr; ++i)
+    {
+      const size_t u = lines->up[i];
+      const size_t l = lines->low[i];
+      const double energy = lines->energy[i];
+      const double einst = lines->einst[i];
+      const double u_weight = gsl_vector_get (mol->weight, u);
+      const double l_weight = gsl_vector_get (mol->weight, l);
+
+      const size_t uu = (u * n + u) * lanes;
+      const size_t ll = (l * n + l) * lanes;
+      const size_t ul = (u * n + l) * lanes;
+      const size_t lu = (l * n + u) * lanes;
+      const double *u_pop = batch->pop + u * lanes;
+      const double *l_pop = batch->pop + l * lanes;
+      double *tau = batch->tau + i * lanes;
+
+      for (size_t k = 0; k < w; ++k)
+        {
+          if (batch->lane_iter[k] == 0)
+            {
+              double coef = RXI_FK * energy / batch->temp_bg[k];
+              if (coef >= 160)
+                coef = 0;
+              else
+                coef = 1 / (exp (coef) - 1);
+
+              const double emission = einst * (1 + coef);
+              const double absorption = einst * lines->weight_ratio[i] * coef;
+              rates[uu + k] = coll[uu + k] + emission;
+              rates[ll + k] = coll[ll + k] + absorption;
+              rates[ul + k] = coll[ul + k] - absorption;
+              rates[lu + k] = coll[lu + k] - emission;
+              continue;
+            }
+
+          tau[k] = rxi_calc_optical_depth (batch->col_dens[k],
+              batch->line_width[k], energy, einst, u_weight, l_weight,
+              u_pop[k], l_pop[k]);
+          if (tau[k] > 1e-2)
+            ++batch->thick_lines[k];
+        }
+    }
+
+  escape_probs (batch, w);
+
+  for (size_t i = 0; i < batch->numof_radtr; ++i)
+    {
+      const size_t u = lines->up[i];
+      const size_t l = lines->low[i];
+      const double einst = lines->einst[i];
+
+      double *uu = rates + (u * n + u) * lanes;
+      double *ll = rates + (l * n + l) * lanes;
+      double *ul = rates + (u * n + l) * lanes;
+      double *lu = rates + (l * n + u) * lanes;
+
+      for (size_t k = 0; k < w; ++k)
+        {
+          if (batch->lane_iter[k] == 0)
+            continue;
+
+          const double beta = batch->beta[i * lanes + k];
+          const double coef = batch->bgfield[i * lanes + k] * beta
+                              / lines->occ_norm[i];
+          const double emission = einst * (beta + coef);
+          const double absorption = einst * lines->weight_ratio[i] * coef;
+          uu[k] += emission;
+          ll[k] += absorption;
+          ul[k] -= absorption;
+          lu[k] -= emission;
+        }
+    }
+
+  // Last equation normalizes populations
+  for (size_t j = 0; j < n; ++j)
+    {
+      for (size_t k = 0; k < w; ++k)
+        rates[((n - 1) * n + j) * lanes + k] = 1;
+    }
+  for (size_t i = 0; i < n * lanes; ++i)
+    batch->rhs[i] = 0;
+  for (size_t k = 0; k < w; ++k)
+    batch->rhs[(n - 1) * lanes + k] = 1;
+}
+
+// Gaussian elimination with partial pivoting in each of the first `w`
+// lanes, leaving solutions in `batch->rhs`. Operations in each lane follow
+// the unblocked `gsl_linalg_LU_decomp()` followed by `gsl_linalg_LU_solve()`;
+// newer GSL factorizes in a different order, so results agree to rounding.
+static void
+solve_lanes (struct rxi_calc_batch *batch, const size_t w)
+{
+  const size_t n = batch->numof_enlev;
+  const size_t lanes = batch->numof_lanes;
+  double *a = batch->rates;
+  double *b = batch->rhs;
+  double *max = batch->lane_tmp;
+  size_t *piv = batch->pivot_row;
+
+#define A(i, j) (a + ((i) * n + (j)) * lanes)
+
+  for (size_t j = 0; j + 1 < n; ++j)
+    {
+      for (size_t k = 0; k < w; ++k)
+        {
+          max[k] = fabs (A (j, j)[k]);
+          piv[k] = j;
+        }
+      for (size_t i = j + 1; i < n; ++i)
+        {
+          const double *a_ij = A (i, j);
+          for (size_t k = 0; k < w; ++k)
+            {
+              // Selects instead of branches keep this loop vectorized
+              const double abs_ij = fabs (a_ij[k]);
+              const bool larger = abs_ij > max[k];
+              max[k] = larger ? abs_ij : max[k];
+              piv[k] = larger ? i : piv[k];
+            }
+        }
+
+      // Pivot rows differ between lanes, so rows are swapped lane by lane
+      for (size_t k = 0; k < w; ++k)
+        {
+          if (piv[k] == j)
+            continue;
+
+          for (size_t c = 0; c < n; ++c)
+            {
+              const double tmp = A (j, c)[k];
+              A (j, c)[k] = A (piv[k], c)[k];
+              A (piv[k], c)[k] = tmp;
+            }
+          const double tmp = b[j * lanes + k];
+          b[j * lanes + k] = b[piv[k] * lanes + k];
+          b[piv[k] * lanes + k] = tmp;
+        }
+
+      for (size_t i = j + 1; i < n; ++i)
+        {
+          lanes_div (w, A (i, j), A (j, j));
+          for (size_t c = j + 1; c < n; ++c)
+            lanes_sub_mul (w, A (i, c), A (i, j), A (j, c));
+        }
+    }
+
+  for (size_t i = 1; i < n; ++i)
+    {
+      for (size_t c = 0; c < i; ++c)
+        lanes_sub_mul (w, b + i * lanes, A (i, c), b + c * lanes);
+    }
+
+  for (size_t i = n; i-- > 0;)
+    {
+      for (size_t c = i + 1; c < n; ++c)
+        lanes_sub_mul (w, b + i * lanes, A (i, c), b + c * lanes);
+      lanes_div (w, b + i * lanes, A (i, i));
+    }
+
+#undef A
+}
+
+// Populations, excitation temperatures and optical depths of the first `w`
+// lanes from the solutions, as on every iteration of the one-model solver
+static void
+update_populations (struct rxi_calc_batch *batch,
+                    const struct rxi_calc_data *mol, const size_t w)
+{
+  const size_t n = batch->numof_enlev;
+  const size_t lanes = batch->numof_lanes;
+  const double *x = batch->rhs;
+  double *total_pop = batch->lane_tmp;
+
+  for (size_t k = 0; k < w; ++k)
+    total_pop[k] = 0;
+  for (size_t i = 0; i < n; ++i)
+    lanes_add (w, total_pop, x + i * lanes);
+
+  for (size_t i = 0; i < n; ++i)
+    {
+      double *pop = batch->pop + i * lanes;
+      double *prev_pop = batch->prev_pop + i * lanes;
+      for (size_t k = 0; k < w; ++k)
+        {
+          prev_pop[k] = pop[k];
+          pop[k] = fabs (x[i * lanes + k] / total_pop[k]);
+          if (batch->lane_iter[k] == 0)
+            prev_pop[k] = pop[k];
+        }
+    }
+
+  for (size_t i = 0; i < batch->numof_radtr; ++i)
+    {
+      const unsigned int u = mol->up[i] - 1;
+      const unsigned int l = mol->low[i] - 1;
+      const double energy = gsl_vector_get (mol->term, u)
+                            - gsl_vector_get (mol->term, l);
+      const double einst = gsl_vector_get (mol->einst, i);
+      const double u_weight = gsl_vector_get (mol->weight, u);
+      const double l_weight = gsl_vector_get (mol->weight, l);
+      const double *u_pop = batch->pop + u * lanes;
+      const double *l_pop = batch->pop + l * lanes;
+      double *excit_temp = batch->excit_temp + i * lanes;
+
+      for (size_t k = 0; k < w; ++k)
+        {
+          const double new_excit_temp =
+              RXI_FK * energy / log (l_pop[k] * u_weight / u_pop[k] / l_weight);
+
+          if (batch->lane_iter[k] == 0)
+            {
+              excit_temp[k] = new_excit_temp;
+              batch->stop_cond[k] = 1;
+            }
+          else
+            {
+              excit_temp[k] = 0.5 * (new_excit_temp + excit_temp[k]);
+            }
+
+          const double new_tau = rxi_calc_optical_depth (batch->col_dens[k],
+              batch->line_width[k], energy, einst, u_weight, l_weight,
+              u_pop[k], l_pop[k]);
+          if (new_tau > 0.01)
+            batch->stop_cond[k] += fabs ((excit_temp[k] - new_excit_temp)
+                                         / new_excit_temp);
+
+          batch->tau[i * lanes + k] = new_tau;
+        }
+    }
+
+  for (size_t i = 0; i < n; ++i)
+    {
+      double *pop = batch->pop + i * lanes;
+      const double *prev_pop = batch->prev_pop + i * lanes;
+      for (size_t k = 0; k < w; ++k)
+        pop[k] = 0.3 * pop[k] + 0.7 * prev_pop[k];
+    }
+
+  for (size_t k = 0; k < w; ++k)
+    ++batch->lane_iter[k];
+}
+
+// Writes the solution of lane `k` to its model
+static void
+finish_lane (struct rxi_calc_batch *batch, const size_t k)
+{
+  const size_t lanes = batch->numof_lanes;
+  struct rxi_calc_data *data = batch->lane_data[k];
+
+  for (size_t i = 0; i < batch->numof_enlev; ++i)
+    gsl_vector_set (data->pop, i, batch->pop[i * lanes + k]);
+  for (size_t i = 0; i < batch->numof_radtr; ++i)
+    {
+      gsl_vector_set (data->tau, i, batch->tau[i * lanes + k]);
+      gsl_vector_set (data->excit_temp, i, batch->excit_temp[i * lanes + k]);
+    }
+
+  data->numof_iter = batch->lane_iter[k];
+  data->linear_residual = 0;
+  data->relax = 0;
+  data->numof_fallbacks = 0;
+  data->ready &= ~RXI_STAGE_PREPARE;
+  rxi_calc_results (data, batch->numof_radtr);
+}
+
+RXI_STAT
+rxi_calc_find_rates_batch (struct rxi_calc_data **data, const size_t n_models,
+                           struct rxi_calc_batch *batch)
+{
+  if (n_models == 0)
+    return RXI_OK;
+
+  DEBUG ("Solve %zu models in %zu lanes", n_models, batch->numof_lanes);
+  ASSERT ((data[0]->numof_enlev == batch->numof_enlev)
+          && (data[0]->numof_radtr == batch->numof_radtr)
+          && "Batch size mismatch");
+
+  // Spare lanes repeat the first model, so all lanes hold sane numbers
+  size_t next = 0;
+  size_t n_active = 0;
+  for (size_t k = 0; k < batch->numof_lanes; ++k)
+    {
+      if (next < n_models)
+        {
+          load_lane (batch, k, data[next++]);
+          ++n_active;
+        }
+      else
+        {
+          load_lane (batch, k, data[0]);
+        }
+    }
+
+  while (n_active > 0)
+    {
+      const size_t w = (n_active + RXI_BATCH_STEP - 1)
+                       / RXI_BATCH_STEP * RXI_BATCH_STEP;
+      assemble_rates (batch, data[0], w);
+      solve_lanes (batch, w);
+      update_populations (batch, data[0], w);
+
+      // Lanes above `k` are settled, so the last active lane can fill the
+      // place of a finished one
+      for (size_t k = n_active; k-- > 0;)
+        {
+          const int thick_lines = batch->thick_lines[k];
+          if (thick_lines != 0
+              && batch->stop_cond[k] / thick_lines >= 1e-7
+              && batch->lane_iter[k] < 300)
+            continue;
+
+          DEBUG ("Lane %zu finished after %u iterations", k,
+                 batch->lane_iter[k]);
+          finish_lane (batch, k);
+          if (next < n_models)
+            {
+              load_lane (batch, k, data[next++]);
+            }
+          else
+            {
+              --n_active;
+              if (k != n_active)
+                move_lane (batch, k, n_active);
+            }
+        }
+    }
+
+  return RXI_OK;
+}
@@ -0,0 +1,29 @@
+/**
+ * @file core/batch.h
+ * @brief Statistical equilibrium for many models of one molecule at once.
+ */
+
+#ifndef RXI_BATCH_H
+#define RXI_BATCH_H
+
+#include "rxi_common.h"
+
+/// @brief Solves statistical equilibrium for several models of one molecule.
+///
+/// Runs the fixed-point iteration of `rxi_calc_find_rates()` with default
+/// solver options for up to `batch->numof_lanes` models at once, one model
+/// per lane of @p batch. Each model leaves the batch as soon as it
+/// converges, and the next one takes its lane. Ng acceleration, Newton
+/// steps, warm starts and linear solver options are not used; escape
+/// probability tables are used if the first model asks for them.
+/// @param **data -- models filled by `rxi_calc_data_init()`, all for the
+/// molecule @p batch was allocated for; results are written to them as by
+/// `rxi_calc_find_rates()`;
+/// @param n_models -- number of models in @p data;
+/// @param *batch -- storage allocated by `rxi_calc_batch_malloc()`.
+/// @return `RXI_OK`
+RXI_STAT rxi_calc_find_rates_batch (struct rxi_calc_data **data,
+                                    const size_t n_models,
+                                    struct rxi_calc_batch *batch);
+
+#endif  // RXI_BATCH_H
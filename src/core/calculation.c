@@ -3,130 +3,609 @@
  */
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include <float.h>
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_linalg.h>
+#include <gsl/gsl_blas.h>
 
 #include "core/calculation.h"
 
 #include "rxi_common.h"
 #include "core/background.h"
+#include "core/batch.h"
+#include "core/coll_cache.h"
+#include "core/coll_interp.h"
+#include "core/escape_table.h"
+#include "core/linalg.h"
 #include "utils/database.h"
 #include "utils/debug.h"
 
+//! Elements processed at once by array kernels. Temporaries of one chunk stay
+//! on the stack, and fixed trip counts let the compiler vectorize the loops.
+#define RXI_ARRAY_CHUNK 64
+
+//! Relative difference of ratios of column density to line width below which
+//! models of a net are solved as one.
+#define RXI_NET_RATIO_TOL 1e-12
+
+// Array kernels are built for AVX-512, AVX2 and baseline x86-64; the dynamic
+// loader picks the best version for the CPU when the program starts
+#if defined(__x86_64__) && defined(__has_attribute)
+#if __has_attribute (target_clones)
+#define RXI_SIMD_CLONES \
+  __attribute__ ((target_clones ("avx512f", "avx2", "default")))
+#endif
+#endif
+#ifndef RXI_SIMD_CLONES
+#define RXI_SIMD_CLONES
+#endif
+// Kernels are inlined into every clone to be built for its instruction set
+#define RXI_KERNEL static inline __attribute__ ((always_inline))
+
+//! Weight of new populations in the under-relaxed iteration of RADEX.
+#define RXI_RELAX 0.3
+//! Smallest weight chosen by `--adaptive-relax`.
+#define RXI_RELAX_MIN 0.15
+
+//! Largest population of the highest solved level for which a truncation of
+//! levels by `--truncate` is accepted.
+#define RXI_TRUNC_POP 1e-10
+
+//! Lines whose emission or absorption terms changed relatively by more than
+//! this since the factorization join the low-rank update of
+//! `--linear-solver lowrank`; smaller changes are left to refinement.
+#define RXI_LOWRANK_TOL 1e-6
+//! The rate matrix is factorized again when more than `numof_enlev` divided
+//! by this lines changed.
+#define RXI_LOWRANK_RATIO 4
+
+//! Iterations between full sweeps over lines with `--freeze-lines`.
+#define RXI_FREEZE_SWEEP 8
+
+//! `--fast-paths` takes populations of LTE when radiative rates out of every
+//! level are below this fraction of the collisional ones, i.e. densities of
+//! partners exceed critical densities of all levels by its inverse.
+#define RXI_LTE_RATIO 1e-6
+//! `--fast-paths` solves once with escape probabilities of one when all lines
+//! would be thinner than this even with all molecules on their lower levels.
+#define RXI_THIN_TAU 1e-3
+//! Largest relative change of populations above 1e-8 by the iteration from
+//! those of a fast path allowed by `RXI_CHECK_FAST_PATHS` builds.
+#define RXI_FAST_CHECK_TOL 1e-3
+
+// Emission and absorption terms of line `i` in the rate matrix for escape
+// probabilities `beta` and background intensities `bgfield` of lines
+static inline void
+line_terms (const struct rxi_calc_lines *lines, const double *beta,
+            const double *bgfield, const size_t i, double *emission,
+            double *absorption)
+{
+  const double coef = bgfield[i] * beta[i] / lines->occ_norm[i];
+  *emission = lines->einst[i] * (beta[i] + coef);
+  *absorption = lines->einst[i] * lines->weight_ratio[i] * coef;
+}
+
+// Builds the rate matrix of an iteration in one pass over the lines: a copy
+// of `rates_archive` with radiative terms on top. Escape probabilities are
+// taken from `data->beta`. On the optically thin start (`thin`) they are one,
+// the background is the black body at `temp_bg`, and terms of a line replace
+// those of earlier lines of the same level instead of adding to them.
 static void
-set_starting_conditions (struct rxi_calc_data *data, const int n_radtr)
+assemble_rates (struct rxi_calc_data *data, const int n_radtr,
+                const bool thin)
 {
-  DEBUG ("Set starting conditions; matrix size: %zu", data->einst->size1);
+  const struct rxi_calc_lines *lines = &data->lines;
+  const size_t tda = data->rates->tda;
+  const double *base = gsl_matrix_const_ptr (data->rates_archive, 0, 0);
+  double *rates = gsl_matrix_ptr (data->rates, 0, 0);
+
+  gsl_matrix_memcpy (data->rates, data->rates_archive);
+
+  if (thin)
+    {
+      for (int i = 0; i < n_radtr; ++i)
+        {
+          const size_t uu = lines->up[i] * tda + lines->up[i];
+          const size_t ll = lines->low[i] * tda + lines->low[i];
+          const size_t ul = lines->up[i] * tda + lines->low[i];
+          const size_t lu = lines->low[i] * tda + lines->up[i];
+
+          double coef = RXI_FK * lines->energy[i] / data->input.temp_bg;
+          if (coef >= 160)
+            coef = 0;
+          else
+            coef = 1 / (exp (coef) - 1);
+
+          const double emission = lines->einst[i] * (1 + coef);
+          const double absorption = lines->einst[i] * lines->weight_ratio[i]
+                                    * coef;
+          rates[uu] = base[uu] + emission;
+          rates[ll] = base[ll] + absorption;
+          rates[ul] = base[ul] - absorption;
+          rates[lu] = base[lu] - emission;
+        }
+      return;
+    }
+
+  const double *beta = gsl_vector_const_ptr (data->beta, 0);
+  const double *bgfield = gsl_vector_const_ptr (data->bgfield, 0);
   for (int i = 0; i < n_radtr; ++i)
     {
-      const unsigned int u = data->up[i] - 1;
-      const unsigned int l = data->low[i] - 1;
+      const size_t u = lines->up[i];
+      const size_t l = lines->low[i];
+
+      double emission, absorption;
+      line_terms (lines, beta, bgfield, i, &emission, &absorption);
+      rates[u * tda + u] += emission;
+      rates[l * tda + l] += absorption;
+      rates[u * tda + l] -= absorption;
+      rates[l * tda + u] -= emission;
+    }
+}
 
-      double coef = RXI_FK
-                    * (gsl_vector_get (data->term, u)
-                      - gsl_vector_get (data->term, l))
-                    / data->input.temp_bg;
+static void
+set_starting_conditions (struct rxi_calc_data *data, const int n_radtr)
+{
+  DEBUG ("Set starting conditions; matrix size: %zu", data->numof_enlev);
+  assemble_rates (data, n_radtr, true);
+  gsl_vector_set_zero (data->pop);
+  gsl_vector_set_zero (data->tau);
+  gsl_vector_set_zero (data->excit_temp);
+  gsl_vector_set_zero (data->antenna_temp);
+  gsl_vector_set_zero (data->radiation_temp);
+}
 
-      if (coef >= 160)
-        coef = 0;
-      else
-        coef = 1 / (exp (coef) - 1);
+// Escape probabilities `beta` of `n` optical depths `tau` for the geometry
+// and method of `data`
+static void
+escape_probs_of (const struct rxi_calc_data *data, const size_t n,
+                 const double *tau, double *beta)
+{
+  if (data->input.solver.escape_table)
+    rxi_calc_escape_prob_table (data->input.geom, n, tau, beta);
+  else
+    rxi_calc_escape_prob_array (data->input.geom, n, tau, beta);
+}
 
-      const double uu = gsl_matrix_get (data->rates_archive, u, u)
-                        + gsl_matrix_get (data->einst, u, l) * (1 + coef);
+// Fills `data->beta` for optical depths of the first `n_radtr` lines
+static void
+escape_probs (struct rxi_calc_data *data, const size_t n_radtr)
+{
+  escape_probs_of (data, n_radtr, gsl_vector_const_ptr (data->tau, 0),
+                   gsl_vector_ptr (data->beta, 0));
+}
 
-      const double ll = gsl_matrix_get (data->rates_archive, l, l)
-                        + gsl_matrix_get (data->einst, u, l)
-                          * gsl_vector_get (data->weight, u) * coef
-                          / gsl_vector_get (data->weight, l);
+static int
+refresh_starting_conditions (struct rxi_calc_data *data, const int n_radtr)
+{
+  const struct rxi_calc_lines *lines = &data->lines;
+  const double *weight = gsl_vector_const_ptr (data->weight, 0);
+  const double *pop = gsl_vector_const_ptr (data->pop, 0);
+  double *tau = gsl_vector_ptr (data->tau, 0);
 
-      const double ul = gsl_matrix_get (data->rates_archive, u, l)
-                        - gsl_matrix_get (data->einst, u, l)
-                          * gsl_vector_get (data->weight, u) * coef
-                          / gsl_vector_get (data->weight, l);
+  int thick_lines = 0;
+  for (int i = 0; i < n_radtr; ++i)
+    {
+      const size_t u = lines->up[i];
+      const size_t l = lines->low[i];
 
-      const double lu = gsl_matrix_get (data->rates_archive, l, u)
-                        - gsl_matrix_get (data->einst, u, l) * (1 + coef);
+      tau[i] = rxi_calc_optical_depth (data->input.col_dens,
+          data->input.line_width, lines->energy[i], lines->einst[i],
+          weight[u], weight[l], pop[u], pop[l]);
+      if (tau[i] > 1e-2)
+        ++thick_lines;
+    }
 
-      gsl_matrix_set (data->rates, u, u, uu);
-      gsl_matrix_set (data->rates, l, l, ll);
-      gsl_matrix_set (data->rates, u, l, ul);
-      gsl_matrix_set (data->rates, l, u, lu);
+  escape_probs (data, n_radtr);
+  assemble_rates (data, n_radtr, false);
 
-    }
-  gsl_vector_set_zero (data->pop);
-  gsl_matrix_set_zero (data->tau);
-  gsl_matrix_set_zero (data->excit_temp);
-  gsl_matrix_set_zero (data->antenna_temp);
-  gsl_matrix_set_zero (data->radiation_temp);
+  return thick_lines;
 }
 
+// `refresh_starting_conditions()` which updates only lines of
+// `data->active`; escape probabilities are computed for their optical depths
+// gathered into `data->active_tau`
 static int
-refresh_starting_conditions (struct rxi_calc_data *data, const int n_radtr)
+refresh_active_lines (struct rxi_calc_data *data, const int n_radtr)
 {
+  const struct rxi_calc_lines *lines = &data->lines;
+  const double *weight = gsl_vector_const_ptr (data->weight, 0);
+  const double *pop = gsl_vector_const_ptr (data->pop, 0);
+  double *tau = gsl_vector_ptr (data->tau, 0);
+  double *beta = gsl_vector_ptr (data->beta, 0);
+
   int thick_lines = 0;
-  gsl_matrix_set_all (data->rates, 1e-30);
-  for (int i = 0; i < n_radtr; ++i)
+  for (size_t k = 0; k < data->numof_active; ++k)
     {
-      const unsigned int u = data->up[i] - 1;
-      const unsigned int l = data->low[i] - 1;
+      const size_t i = data->active[k];
+      const size_t u = lines->up[i];
+      const size_t l = lines->low[i];
+
+      tau[i] = rxi_calc_optical_depth (data->input.col_dens,
+          data->input.line_width, lines->energy[i], lines->einst[i],
+          weight[u], weight[l], pop[u], pop[l]);
+      data->active_tau[k] = tau[i];
+      if (tau[i] > 1e-2)
+        ++thick_lines;
+    }
 
-      double energy = gsl_vector_get (data->term, u)
-                      - gsl_vector_get (data->term, l);
-      const double tau = rxi_calc_optical_depth (data->input.col_dens,
-          data->input.line_width, energy,
-          gsl_matrix_get (data->einst, u, l),
-          gsl_vector_get (data->weight, u), gsl_vector_get (data->weight, l),
-          gsl_vector_get (data->pop, u), gsl_vector_get (data->pop, l));
+  escape_probs_of (data, data->numof_active, data->active_tau,
+                   data->active_beta);
+  for (size_t k = 0; k < data->numof_active; ++k)
+    beta[data->active[k]] = data->active_beta[k];
+  assemble_rates (data, n_radtr, false);
 
-      gsl_matrix_set (data->tau, u, l, tau);
-      if (tau > 1e-2)
-        ++thick_lines;
+  return thick_lines;
+}
+
+// Fills entry `i` of the transition table from levels and Einstein
+// coefficient of line `i`
+static void
+fill_line (struct rxi_calc_data *data, const size_t i)
+{
+  const size_t u = data->up[i] - 1;
+  const size_t l = data->low[i] - 1;
+  const double energy = gsl_vector_get (data->term, u)
+                        - gsl_vector_get (data->term, l);
+
+  data->lines.up[i] = u;
+  data->lines.low[i] = l;
+  data->lines.einst[i] = gsl_vector_get (data->einst, i);
+  data->lines.weight_ratio[i] = gsl_vector_get (data->weight, u)
+                                / gsl_vector_get (data->weight, l);
+  data->lines.energy[i] = energy;
+  data->lines.occ_norm[i] = 2 * RXI_HP * RXI_SOL * gsl_pow_3 (energy);
+}
+
+// Fills `rates_archive` from `coll_rates` and `tot_rates`
+static void
+fill_rates_archive (struct rxi_calc_data *data)
+{
+  const size_t n = data->rates_archive->size1;
+  for (size_t i = 0; i < n; ++i)
+    {
+      double *row = gsl_matrix_ptr (data->rates_archive, i, 0);
+      for (size_t j = 0; j < n; ++j)
+        row[j] = 1e-30 - gsl_matrix_get (data->coll_rates, j, i);
+      row[i] = 1e-30 + gsl_vector_get (data->tot_rates, i);
+    }
+}
+
+// Fills levels, lines and the transition table of `calc_data`
+static void
+fill_levels (const struct rxi_db_molecule_info *mol_info,
+             const struct rxi_db_molecule_enlev *mol_enlev,
+             const struct rxi_db_molecule_radtr *mol_radtr,
+             struct rxi_calc_data *calc_data)
+{
+  DEBUG ("Setting terms and molecular weights");
 
-      const double beta = rxi_calc_escape_prob (tau, data->input.geom);
+  gsl_vector_set_zero (calc_data->term);
+  gsl_vector_set_zero (calc_data->weight);
+  gsl_vector_set_zero (calc_data->einst);
+  gsl_vector_set_zero (calc_data->freq);
+  gsl_vector_set_zero (calc_data->bgfield);
 
-      const double coef =
-              (gsl_matrix_get (data->bgfield, u, l) * beta)
-          / //---------------------------------------------
-               (2 * RXI_HP * RXI_SOL * gsl_pow_3 (energy));
+  for (int i = 0; i < mol_info->numof_enlev; ++i)
+    {
+      gsl_vector_set (calc_data->term, mol_enlev->level[i] - 1,
+                      mol_enlev->term[i]);
+      gsl_vector_set (calc_data->weight, mol_enlev->level[i] - 1,
+                      mol_enlev->weight[i]);
+    }
 
-      // DEBUG ("%d %d: coef = %.3e | beta %.3e", u, l, coef, beta);
+  DEBUG ("Setting Einstein coefs and energies");
 
-      const double uu = gsl_matrix_get (data->rates, u, u)
-                        + gsl_matrix_get (data->einst, u, l) * (beta + coef);
+  for (int i = 0; i < mol_info->numof_radtr; ++i)
+    {
+      calc_data->up[i] = mol_radtr->up[i];
+      calc_data->low[i] = mol_radtr->low[i];
+      gsl_vector_set (calc_data->einst, i, mol_radtr->einst[i]);
+      gsl_vector_set (calc_data->freq, i, mol_radtr->freq[i]);
+    }
 
-      const double ll = gsl_matrix_get (data->rates, l, l)
-                        + gsl_matrix_get (data->einst, u, l)
-                          * gsl_vector_get (data->weight, u)
-                          / gsl_vector_get (data->weight, l) * coef;
+  for (int i = 0; i < mol_info->numof_radtr; ++i)
+    fill_line (calc_data, i);
+}
 
-      const double ul = gsl_matrix_get (data->rates, u, l)
-                        - gsl_matrix_get (data->einst, u, l)
-                          * gsl_vector_get (data->weight, u)
-                          / gsl_vector_get (data->weight, l) * coef;
+// Fills `boltz` for kinetic temperature `temp_kin`
+static void
+fill_boltz (struct rxi_calc_data *data, const double temp_kin)
+{
+  const double *term = gsl_vector_const_ptr (data->term, 0);
+  const double *weight = gsl_vector_const_ptr (data->weight, 0);
+  double *boltz = gsl_vector_ptr (data->boltz, 0);
+  for (size_t i = 0; i < data->boltz->size; ++i)
+    boltz[i] = weight[i] * exp (- RXI_FK * term[i] / temp_kin);
+}
 
-      const double lu = gsl_matrix_get (data->rates, l, u)
-                        - gsl_matrix_get (data->einst, u, l) * (beta + coef);
+// Adds rates of `n` collisional transitions of a partner with density `dens`
+// to `coll_rates` and `tot_rates`: downward ones from `coefs` and upward
+// ones by detailed balance. Only transitions with collisional data are
+// visited, and `boltz` of `data` must be filled for `temp_kin`.
+static void
+add_partner_rates (const struct rxi_calc_data *data, gsl_matrix *coll_rates,
+                   gsl_vector *tot_rates, const int *up, const int *low,
+                   const double *coefs, const size_t n, const double dens,
+                   const double temp_kin)
+{
+  const double *term = gsl_vector_const_ptr (data->term, 0);
+  const double *weight = gsl_vector_const_ptr (data->weight, 0);
+  const double *boltz = gsl_vector_const_ptr (data->boltz, 0);
+  double *coll = gsl_matrix_ptr (coll_rates, 0, 0);
+  double *tot = gsl_vector_ptr (tot_rates, 0);
+  const size_t tda = coll_rates->tda;
+
+  for (size_t k = 0; k < n; ++k)
+    {
+      // Rates go down from the level with higher energy
+      size_t i = up[k] - 1;
+      size_t j = low[k] - 1;
+      if (term[i] < term[j])
+        {
+          const size_t t = i;
+          i = j;
+          j = t;
+        }
 
-      gsl_matrix_set (data->rates, u, u, uu);
-      gsl_matrix_set (data->rates, l, l, ll);
-      gsl_matrix_set (data->rates, u, l, ul);
-      gsl_matrix_set (data->rates, l, u, lu);
+      // And here coefficients become collisional rates
+      const double down = coefs[k] * dens;
+      // Factors of levels far above kinetic temperature underflow, and
+      // their ratio does not hold then
+      const double upward = (boltz[i] >= DBL_MIN && boltz[j] >= DBL_MIN)
+          ? boltz[i] / boltz[j] * down
+          : rxi_calc_crate (weight[i], weight[j], term[i] - term[j],
+                            temp_kin, down);
+
+      coll[i * tda + j] += down;
+      coll[j * tda + i] += upward;
+      tot[i] += down;
+      tot[j] += upward;
+    }
+}
+
+// Interpolation of the partner `coll_part` of `mol_info` to `temp_kin`
+static void
+init_partner_interp (struct rxi_coll_interp *interp,
+                     const struct rxi_db_molecule_info *mol_info,
+                     const COLL_PART coll_part, const COLL_INTERP method,
+                     const double temp_kin)
+{
+  // Get index number (from .info file) of entered collisional partner
+  int8_t cp = cptonum (mol_info, coll_part);
+
+  // Rows of these matrices are contiguous, so they are read in place
+  rxi_coll_interp_init (interp, method,
+                        gsl_matrix_const_ptr (mol_info->coll_temps, cp, 0),
+                        mol_info->numof_coll_temps[cp], temp_kin);
+}
+
+// Fills `coll_rates` and `tot_rates` of `calc_data`; levels must be filled
+static void
+fill_coll_rates (const struct rxi_input_data *inp_data,
+                 const struct rxi_db_molecule_info *mol_info,
+                 struct rxi_db_molecule_coll_part **mol_cp,
+                 struct rxi_calc_data *calc_data)
+{
+  DEBUG ("Setting collision rates");
+
+  gsl_matrix_set_zero (calc_data->coll_rates);
+  gsl_vector_set_zero (calc_data->tot_rates);
+  fill_boltz (calc_data, inp_data->temp_kin);
+
+  for (int p = 0; p < inp_data->n_coll_partners; ++p)
+    {
+      const gsl_matrix *cp_rates = mol_cp[p]->coll_rates;
+      struct rxi_coll_interp interp;
+      init_partner_interp (&interp, mol_info, inp_data->coll_part[p],
+                           inp_data->solver.coll_interp, inp_data->temp_kin);
+
+      const size_t n_trans = mol_info->numof_coll_trans[
+          cptonum (mol_info, inp_data->coll_part[p])];
+      for (size_t j = 0; j < n_trans; j += RXI_ARRAY_CHUNK)
+        {
+          double coefs[RXI_ARRAY_CHUNK];
+          const size_t n = (n_trans - j < RXI_ARRAY_CHUNK)
+                           ? n_trans - j : RXI_ARRAY_CHUNK;
+          rxi_coll_interp_rates (&interp, n,
+                                 gsl_matrix_const_ptr (cp_rates, j, 0),
+                                 cp_rates->tda, coefs);
+          add_partner_rates (calc_data, calc_data->coll_rates,
+                             calc_data->tot_rates, mol_cp[p]->up + j,
+                             mol_cp[p]->low + j, coefs, n,
+                             inp_data->coll_part_dens[p],
+                             inp_data->temp_kin);
+        }
     }
-  return thick_lines;
 }
 
 RXI_STAT
-rxi_calc_data_init (struct rxi_calc_data *calc_data,
-                    const struct rxi_input_data *inp_data,
-                    const struct rxi_db_molecule_info *mol_info)
+rxi_calc_data_fill (const struct rxi_input_data *inp_data,
+                    const struct rxi_db_molecule_info *mol_info,
+                    const struct rxi_db_molecule_enlev *mol_enlev,
+                    const struct rxi_db_molecule_radtr *mol_radtr,
+                    struct rxi_db_molecule_coll_part **mol_cp,
+                    struct rxi_calc_data *calc_data)
 {
-  DEBUG ("Calculation data initialization for %s", inp_data->name);
+  fill_levels (mol_info, mol_enlev, mol_radtr, calc_data);
+  fill_coll_rates (inp_data, mol_info, mol_cp, calc_data);
+  fill_rates_archive (calc_data);
+
+  return RXI_OK;
+}
+
+// Frees tables and rates of collisional partners kept in `coll`
+static void
+free_coll_tables (struct rxi_calc_coll *coll)
+{
+  for (int8_t p = 0; p < coll->numof_parts; ++p)
+    {
+      rxi_db_molecule_coll_part_free (coll->table[p]);
+      free (coll->coefs[p]);
+      free (coll->bracket_base[p]);
+      free (coll->bracket_slope[p]);
+      gsl_matrix_free (coll->unit_rates[p]);
+      gsl_vector_free (coll->unit_tot[p]);
+    }
+  *coll = (struct rxi_calc_coll) { .temp_kin = NAN, .refs = coll->refs };
+}
+
+// Gives `calc_data` tables of partners of its own if it shares them, so
+// loading a molecule leaves the other models alone
+static RXI_STAT
+own_coll (struct rxi_calc_data *calc_data)
+{
+  if (calc_data->coll->refs == 1)
+    return RXI_OK;
+
+  struct rxi_calc_coll *coll = malloc (sizeof (*coll));
+  CHECK (coll && "Allocation error");
+  if (!coll)
+    return RXI_ERR_ALLOC;
+
+  *coll = (struct rxi_calc_coll) { .temp_kin = NAN, .refs = 1 };
+  rxi_calc_coll_release (calc_data->coll);
+  calc_data->coll = coll;
+  return RXI_OK;
+}
+
+// Whether inputs of a setup stage differ in `a` and `b`, one function for
+// each stage
+
+static bool
+molecule_changed (const struct rxi_input_data *a,
+                  const struct rxi_input_data *b)
+{
+  if (strcmp (a->name, b->name) != 0
+      || a->n_coll_partners != b->n_coll_partners)
+    return true;
+
+  for (int8_t p = 0; p < a->n_coll_partners; ++p)
+    if (a->coll_part[p] != b->coll_part[p])
+      return true;
+
+  return false;
+}
+
+static bool
+temp_kin_changed (const struct rxi_input_data *a,
+                  const struct rxi_input_data *b)
+{
+  return a->temp_kin != b->temp_kin
+         || a->solver.coll_interp != b->solver.coll_interp;
+}
+
+static bool
+densities_changed (const struct rxi_input_data *a,
+                   const struct rxi_input_data *b)
+{
+  for (int8_t p = 0; p < a->n_coll_partners; ++p)
+    if (a->coll_part_dens[p] != b->coll_part_dens[p])
+      return true;
+
+  return false;
+}
+
+static bool
+temp_bg_changed (const struct rxi_input_data *a,
+                 const struct rxi_input_data *b)
+{
+  return a->temp_bg != b->temp_bg;
+}
+
+static bool
+prepare_changed (const struct rxi_input_data *a,
+                 const struct rxi_input_data *b)
+{
+  return a->col_dens != b->col_dens || a->line_width != b->line_width
+         || a->geom != b->geom;
+}
+
+// Setup stages in the order they run: fields of `struct rxi_input_data`
+// each of them depends on, and stages which use its results
+static const struct
+{
+  RXI_STAGE stage;
+  bool (*changed) (const struct rxi_input_data *a,
+                   const struct rxi_input_data *b);
+  unsigned int users;
+} setup_stages[] = {
+  { RXI_STAGE_MOLECULE, molecule_changed,
+    RXI_STAGE_TEMP_KIN | RXI_STAGE_DENSITIES | RXI_STAGE_TEMP_BG
+    | RXI_STAGE_PREPARE },
+  { RXI_STAGE_TEMP_KIN, temp_kin_changed, RXI_STAGE_DENSITIES },
+  { RXI_STAGE_DENSITIES, densities_changed, RXI_STAGE_PREPARE },
+  { RXI_STAGE_TEMP_BG, temp_bg_changed, RXI_STAGE_PREPARE },
+  { RXI_STAGE_PREPARE, prepare_changed, 0 },
+};
+
+// `stages` and all stages which use their results, directly or not
+static unsigned int
+dependent_stages (unsigned int stages)
+{
+  // Users of a stage run after it, so one pass is enough
+  for (size_t s = 0; s < sizeof (setup_stages) / sizeof (setup_stages[0]);
+       ++s)
+    if (stages & setup_stages[s].stage)
+      stages |= setup_stages[s].users;
+
+  return stages;
+}
+
+// Marks `stage` of `calc_data` done, and the stages using its results as
+// out of date
+static void
+stage_done (struct rxi_calc_data *calc_data, const RXI_STAGE stage)
+{
+  calc_data->ready = (calc_data->ready & ~dependent_stages (stage)) | stage;
+}
+
+// Allocates tables and rates of the next partner of `coll`, which is
+// `inp_data->coll_part[i]`
+static RXI_STAT
+alloc_partner (struct rxi_calc_coll *coll,
+               const struct rxi_input_data *inp_data,
+               const struct rxi_db_molecule_info *mol_info, const int8_t i)
+{
+  int8_t cp = cptonum (mol_info, inp_data->coll_part[i]);
+  const size_t n_trans = mol_info->numof_coll_trans[cp];
+  RXI_STAT status = rxi_db_molecule_coll_part_malloc (&coll->table[i],
+      n_trans, mol_info->numof_coll_temps[cp]);
+  if (status != RXI_OK)
+    return status;
+
+  coll->coefs[i] = malloc (n_trans * sizeof (*coll->coefs[i]));
+  coll->bracket_base[i] = malloc (n_trans * sizeof (*coll->bracket_base[i]));
+  coll->bracket_slope[i] = malloc (n_trans
+                                   * sizeof (*coll->bracket_slope[i]));
+  coll->unit_rates[i] = gsl_matrix_alloc (mol_info->numof_enlev,
+                                          mol_info->numof_enlev);
+  coll->unit_tot[i] = gsl_vector_alloc (mol_info->numof_enlev);
+  CHECK ((coll->coefs[i] && coll->bracket_base[i] && coll->bracket_slope[i]
+          && coll->unit_rates[i] && coll->unit_tot[i]) && "Allocation error");
+  coll->part[i] = inp_data->coll_part[i];
+  coll->numof_trans[i] = n_trans;
+  coll->bracket_lo[i] = SIZE_MAX;
+  coll->numof_parts = i + 1;
+  if (!coll->coefs[i] || !coll->bracket_base[i] || !coll->bracket_slope[i]
+      || !coll->unit_rates[i] || !coll->unit_tot[i])
+    return RXI_ERR_ALLOC;
+
+  return RXI_OK;
+}
+
+RXI_STAT
+rxi_calc_data_load_molecule (struct rxi_calc_data *calc_data,
+                             const struct rxi_db_molecule_info *mol_info)
+{
+  const struct rxi_input_data *inp_data = &calc_data->input;
+  DEBUG ("Loading molecule %s", inp_data->name);
 
-  calc_data->input = *inp_data;
   calc_data->numof_enlev = mol_info->numof_enlev;
   calc_data->numof_radtr = mol_info->numof_radtr;
 
@@ -134,12 +613,12 @@ rxi_calc_data_init (struct rxi_calc_data *calc_data,
   struct rxi_db_molecule_enlev *mol_enl;
   status = rxi_db_molecule_enlev_malloc (&mol_enl, mol_info->numof_enlev);
   if (status != RXI_OK)
-    goto error;
+    return status;
   status = rxi_db_read_molecule_enlev (inp_data->name, mol_enl);
   if (status != RXI_OK)
     {
       rxi_db_molecule_enlev_free (mol_enl);
-      goto error;
+      return status;
     }
 
   DEBUG ("Molecule enlev parameters were read");
@@ -149,355 +628,1690 @@ rxi_calc_data_init (struct rxi_calc_data *calc_data,
   if (status != RXI_OK)
     {
       rxi_db_molecule_enlev_free (mol_enl);
-      goto error;
+      return status;
     }
   status = rxi_db_read_molecule_radtr (inp_data->name, mol_rt);
   if (status != RXI_OK)
     {
       rxi_db_molecule_enlev_free (mol_enl);
       rxi_db_molecule_radtr_free (mol_rt);
-      goto error;
+      return status;
     }
 
   DEBUG ("Molecule radtr parameters were read");
 
-  struct rxi_db_molecule_coll_part **mol_cp = malloc (
-      inp_data->n_coll_partners * sizeof (**mol_cp));
+  fill_levels (mol_info, mol_enl, mol_rt, calc_data);
+  rxi_db_molecule_enlev_free (mol_enl);
+  rxi_db_molecule_radtr_free (mol_rt);
 
+  status = own_coll (calc_data);
+  if (status != RXI_OK)
+    return status;
+  struct rxi_calc_coll *coll = calc_data->coll;
+  free_coll_tables (coll);
   for (int8_t i = 0; i < inp_data->n_coll_partners; ++i)
     {
-      int8_t cp = cptonum (mol_info, inp_data->coll_part[i]);
-      status = rxi_db_molecule_coll_part_malloc (&mol_cp[i],
-          mol_info->numof_coll_trans[cp], mol_info->numof_coll_temps[cp]);
+      status = alloc_partner (coll, inp_data, mol_info, i);
       if (status != RXI_OK)
-        {
-          rxi_db_molecule_enlev_free (mol_enl);
-          rxi_db_molecule_radtr_free (mol_rt);
-          free (*mol_cp);
-          goto error;
-        }
+        goto error;
+
       status = rxi_db_read_molecule_coll_part (inp_data->name,
-          inp_data->coll_part[i], mol_info->numof_coll_temps[cp], mol_cp[i]);
+          inp_data->coll_part[i], mol_info->numof_coll_temps[
+          cptonum (mol_info, inp_data->coll_part[i])], coll->table[i]);
       if (status != RXI_OK)
-        {
-          rxi_db_molecule_enlev_free (mol_enl);
-          rxi_db_molecule_radtr_free (mol_rt);
-          free (*mol_cp);
-          goto error;
-        }
+        goto error;
 
       DEBUG ("Molecule collision transfer parameters were read");
     }
+  strcpy (coll->name, inp_data->name);
+  stage_done (calc_data, RXI_STAGE_MOLECULE);
+
+  return RXI_OK;
+
+error:
+  free_coll_tables (coll);
+  calc_data->ready = 0;
+  return status;
+}
+
+RXI_STAT
+rxi_calc_data_load_tables (struct rxi_calc_data *calc_data,
+    const struct rxi_db_molecule_info *mol_info,
+    const struct rxi_db_molecule_enlev *mol_enlev,
+    const struct rxi_db_molecule_radtr *mol_radtr,
+    struct rxi_db_molecule_coll_part *const *mol_cp)
+{
+  const struct rxi_input_data *inp_data = &calc_data->input;
+  DEBUG ("Loading tables of molecule %s", inp_data->name);
 
-  status = rxi_calc_data_fill (inp_data, mol_info, mol_enl, mol_rt, mol_cp,
-                               calc_data);
+  calc_data->numof_enlev = mol_info->numof_enlev;
+  calc_data->numof_radtr = mol_info->numof_radtr;
+  fill_levels (mol_info, mol_enlev, mol_radtr, calc_data);
+
+  RXI_STAT status = own_coll (calc_data);
   if (status != RXI_OK)
+    return status;
+  struct rxi_calc_coll *coll = calc_data->coll;
+  free_coll_tables (coll);
+  for (int8_t i = 0; i < inp_data->n_coll_partners; ++i)
     {
-      rxi_db_molecule_enlev_free (mol_enl);
-      rxi_db_molecule_radtr_free (mol_rt);
-      for (int8_t i = 0; i < inp_data->n_coll_partners; ++i)
-        rxi_db_molecule_coll_part_free (mol_cp[i]);
-      goto error;
-    }
+      status = alloc_partner (coll, inp_data, mol_info, i);
+      if (status != RXI_OK)
+        {
+          free_coll_tables (coll);
+          calc_data->ready = 0;
+          return status;
+        }
 
-  rxi_calc_bgfield (calc_data, mol_rt, mol_info->numof_radtr);
-  set_starting_conditions (calc_data, mol_info->numof_radtr);
-/*
-  rxi_db_molecule_enlev_free (mol_enl);
-  rxi_db_molecule_radtr_free (mol_rt);
+      struct rxi_db_molecule_coll_part *table = coll->table[i];
+      memcpy (table->up, mol_cp[i]->up,
+              coll->numof_trans[i] * sizeof (*table->up));
+      memcpy (table->low, mol_cp[i]->low,
+              coll->numof_trans[i] * sizeof (*table->low));
+      gsl_matrix_memcpy (table->coll_rates, mol_cp[i]->coll_rates);
+    }
+  strcpy (coll->name, inp_data->name);
+  stage_done (calc_data, RXI_STAGE_MOLECULE);
 
-  for (int8_t i = 0; i < inp_data->n_coll_partners; ++i)
-    rxi_db_molecule_coll_part_free (mol_cp[i]);
-*/
-  return status;
+  return RXI_OK;
+}
 
-error:
-  return status;
+void
+rxi_calc_data_share_molecule (struct rxi_calc_data *calc_data,
+                              const struct rxi_calc_data *owner)
+{
+  ASSERT ((owner->ready & RXI_STAGE_MOLECULE) && "Molecule is not loaded");
+  ASSERT ((calc_data->numof_enlev == owner->numof_enlev
+           && calc_data->numof_radtr == owner->numof_radtr)
+          && "Sizes of models differ");
+
+  const size_t n_radtr = owner->numof_radtr;
+  memcpy (calc_data->up, owner->up, n_radtr * sizeof (*calc_data->up));
+  memcpy (calc_data->low, owner->low, n_radtr * sizeof (*calc_data->low));
+  gsl_vector_memcpy (calc_data->term, owner->term);
+  gsl_vector_memcpy (calc_data->weight, owner->weight);
+  gsl_vector_memcpy (calc_data->einst, owner->einst);
+  gsl_vector_memcpy (calc_data->freq, owner->freq);
+
+  struct rxi_calc_lines *lines = &calc_data->lines;
+  const struct rxi_calc_lines *src = &owner->lines;
+  memcpy (lines->up, src->up, n_radtr * sizeof (*lines->up));
+  memcpy (lines->low, src->low, n_radtr * sizeof (*lines->low));
+  memcpy (lines->einst, src->einst, n_radtr * sizeof (*lines->einst));
+  memcpy (lines->weight_ratio, src->weight_ratio,
+          n_radtr * sizeof (*lines->weight_ratio));
+  memcpy (lines->energy, src->energy, n_radtr * sizeof (*lines->energy));
+  memcpy (lines->occ_norm, src->occ_norm,
+          n_radtr * sizeof (*lines->occ_norm));
+
+  rxi_calc_coll_release (calc_data->coll);
+  calc_data->coll = owner->coll;
+  ++calc_data->coll->refs;
+
+  calc_data->input = owner->input;
+  calc_data->ready = RXI_STAGE_MOLECULE;
 }
 
-static double
-interpolate_cp_rate (const double kin_temp, const double *temps,
-                     const double *rates, const size_t n_temps)
+void
+rxi_calc_data_set_temp_kin (struct rxi_calc_data *calc_data,
+                            const struct rxi_db_molecule_info *mol_info)
 {
-  double lcoef = 0;
-  double ucoef = 0;
-  double ltemp = 0;
-  double utemp = 0;
-  for (size_t i = 0; i < n_temps; ++i)
-    {
-      if (kin_temp > temps[i])
-        continue;
+  const struct rxi_input_data *inp_data = &calc_data->input;
+  struct rxi_calc_coll *coll = calc_data->coll;
+  ASSERT ((coll->numof_parts == inp_data->n_coll_partners)
+          && "Collisional partners are not loaded");
 
-      lcoef = rates[i];
-      ltemp = temps[i];
-      if (i == n_temps - 1)
-        break;
+  DEBUG ("Interpolating collision coefficients to %.3f K",
+         inp_data->temp_kin);
+
+  for (int8_t p = 0; p < coll->numof_parts; ++p)
+    {
+      const gsl_matrix *cp_rates = coll->table[p]->coll_rates;
+      struct rxi_coll_interp interp;
+      init_partner_interp (&interp, mol_info, coll->part[p],
+                           inp_data->solver.coll_interp, inp_data->temp_kin);
+      if (interp.method != CI_LINEAR)
+        {
+          rxi_coll_interp_rates (&interp, coll->numof_trans[p],
+                                 gsl_matrix_const_ptr (cp_rates, 0, 0),
+                                 cp_rates->tda, coll->coefs[p]);
+          continue;
+        }
 
-      ucoef = rates[i + 1];
-      utemp = temps[i + 1];
-      break;
+      // Temperatures of a fine net mostly fall into the bracket of the
+      // previous one, and the table is read again only for a new bracket
+      if (coll->bracket_lo[p] != interp.lo || coll->bracket_hi[p] != interp.hi)
+        {
+          DEBUG ("Reading bracket of temperatures %zu and %zu", interp.lo,
+                 interp.hi);
+          rxi_coll_interp_bracket (&interp, coll->numof_trans[p],
+                                   gsl_matrix_const_ptr (cp_rates, 0, 0),
+                                   cp_rates->tda, coll->bracket_base[p],
+                                   coll->bracket_slope[p]);
+          coll->bracket_lo[p] = interp.lo;
+          coll->bracket_hi[p] = interp.hi;
+        }
+      rxi_coll_interp_blend (&interp, coll->numof_trans[p],
+                             coll->bracket_base[p], coll->bracket_slope[p],
+                             coll->coefs[p]);
     }
+  fill_boltz (calc_data, inp_data->temp_kin);
 
-  /*DEBUG ("lcoef: %.3e | ltemp: %.3e | ucoef: %.3e | utemp: %.3e", lcoef, ltemp,*/
-         /*ucoef, utemp);*/
-  if ((ltemp < 1e-30) && (utemp < 1e-30))
+  // Rates are linear in densities, so a model which differs only in them
+  // needs just a weighted sum of these
+  for (int8_t p = 0; p < coll->numof_parts; ++p)
     {
-      // Case when kinetic temperature is lower than minimum collision rate
-      // temperature
-      return rates[n_temps - 1];
+      gsl_matrix_set_zero (coll->unit_rates[p]);
+      gsl_vector_set_zero (coll->unit_tot[p]);
+      add_partner_rates (calc_data, coll->unit_rates[p], coll->unit_tot[p],
+                         coll->table[p]->up, coll->table[p]->low,
+                         coll->coefs[p], coll->numof_trans[p], 1.0,
+                         inp_data->temp_kin);
     }
-  else if (ltemp > utemp)
+  coll->temp_kin = inp_data->temp_kin;
+  coll->coll_interp = inp_data->solver.coll_interp;
+  stage_done (calc_data, RXI_STAGE_TEMP_KIN);
+}
+
+void
+rxi_calc_data_set_densities (struct rxi_calc_data *calc_data)
+{
+  const struct rxi_input_data *inp_data = &calc_data->input;
+  const struct rxi_calc_coll *coll = calc_data->coll;
+  ASSERT ((coll->temp_kin == inp_data->temp_kin)
+          && "Collision coefficients are not interpolated to temp_kin");
+
+  DEBUG ("Setting collision rates");
+
+  // One scaled copy and then one AXPY per partner over the unit density
+  // rates; a model without partners has no collisions
+  gsl_matrix *coll_rates = calc_data->coll_rates;
+  const size_t n = coll_rates->size1;
+  if (coll->numof_parts == 0)
     {
-      // Case when kinetic temperature is bigger than maximum collision rate
-      // temperature
-      return lcoef;
+      gsl_matrix_set_zero (coll_rates);
+      gsl_vector_set_zero (calc_data->tot_rates);
     }
-  else
+  for (int8_t p = 0; p < coll->numof_parts; ++p)
     {
-      // Make linear interpolation to needed temperature
-      return lcoef +
-              (ucoef - lcoef) * (kin_temp - ltemp)
-          / //------------------------------------
-                        (utemp - ltemp);
+      const double dens = inp_data->coll_part_dens[p];
+      const gsl_matrix *unit = coll->unit_rates[p];
+      for (size_t i = 0; i < n; ++i)
+        {
+          const double *restrict src = gsl_matrix_const_ptr (unit, i, 0);
+          double *restrict dst = gsl_matrix_ptr (coll_rates, i, 0);
+          if (p == 0)
+            for (size_t j = 0; j < n; ++j)
+              dst[j] = dens * src[j];
+          else
+            for (size_t j = 0; j < n; ++j)
+              dst[j] += dens * src[j];
+        }
+
+      const double *restrict src = gsl_vector_const_ptr (coll->unit_tot[p],
+                                                         0);
+      double *restrict dst = gsl_vector_ptr (calc_data->tot_rates, 0);
+      if (p == 0)
+        for (size_t i = 0; i < n; ++i)
+          dst[i] = dens * src[i];
+      else
+        for (size_t i = 0; i < n; ++i)
+          dst[i] += dens * src[i];
     }
+  fill_rates_archive (calc_data);
+  stage_done (calc_data, RXI_STAGE_DENSITIES);
+}
+
+void
+rxi_calc_data_set_temp_bg (struct rxi_calc_data *calc_data)
+{
+  rxi_calc_bgfield (calc_data);
+  stage_done (calc_data, RXI_STAGE_TEMP_BG);
+}
+
+void
+rxi_calc_data_prepare (struct rxi_calc_data *calc_data)
+{
+  set_starting_conditions (calc_data, calc_data->numof_radtr);
+  stage_done (calc_data, RXI_STAGE_PREPARE);
 }
 
-static double*
-get_matrix_row (const gsl_matrix *matrix, const size_t n_row)
+// Fills collisional rates of `calc_data` from the cache or from unit density
+// rates; coefficients are interpolated first if `coll` holds them for
+// another temperature
+static void
+update_rates (struct rxi_calc_data *calc_data,
+              const struct rxi_db_molecule_info *mol_info)
 {
-  double *row = malloc (matrix->size2 * sizeof (*row));
-  for (size_t i = 0; i < matrix->size2; ++i)
+  const struct rxi_input_data *inp_data = &calc_data->input;
+
+  // Models of a net which differ only in column density or line width have
+  // the same collisional rates. Coefficients are left as they are, and
+  // `coll` tells which temperature they are for
+  if (rxi_coll_cache_get (inp_data, calc_data))
+    {
+      DEBUG ("Collisional rates were found in the cache");
+      fill_boltz (calc_data, inp_data->temp_kin);
+      fill_rates_archive (calc_data);
+      calc_data->ready |= RXI_STAGE_TEMP_KIN | RXI_STAGE_DENSITIES;
+      return;
+    }
+
+  // Unit density rates are kept for the last temperature, so models which
+  // differ only in densities just sum them
+  const struct rxi_calc_coll *coll = calc_data->coll;
+  if (coll->temp_kin != inp_data->temp_kin
+      || coll->coll_interp != inp_data->solver.coll_interp)
+    rxi_calc_data_set_temp_kin (calc_data, mol_info);
+  else
     {
-      row[i] = gsl_matrix_get (matrix, n_row, i);
+      fill_boltz (calc_data, inp_data->temp_kin);
+      calc_data->ready |= RXI_STAGE_TEMP_KIN;
     }
+  rxi_calc_data_set_densities (calc_data);
 
-  return row;
+  // The model is solved without the cache as well
+  if (rxi_coll_cache_put (&calc_data->input, calc_data) != RXI_OK)
+    DEBUG ("Collisional rates were not cached");
 }
 
 RXI_STAT
-rxi_calc_data_fill (const struct rxi_input_data *inp_data,
-                    const struct rxi_db_molecule_info *mol_info,
-                    const struct rxi_db_molecule_enlev *mol_enlev,
-                    const struct rxi_db_molecule_radtr *mol_radtr,
-                    struct rxi_db_molecule_coll_part **mol_cp,
-                    struct rxi_calc_data *calc_data)
+rxi_calc_data_update (struct rxi_calc_data *calc_data,
+                      const struct rxi_input_data *inp_data,
+                      const struct rxi_db_molecule_info *mol_info)
 {
-  DEBUG ("Setting terms and molecular weights");
+  unsigned int dirty = 0;
+  for (size_t s = 0; s < sizeof (setup_stages) / sizeof (setup_stages[0]);
+       ++s)
+    {
+      const RXI_STAGE stage = setup_stages[s].stage;
+      if (!(calc_data->ready & stage)
+          || setup_stages[s].changed (&calc_data->input, inp_data))
+        dirty |= stage;
+    }
+  dirty = dependent_stages (dirty);
 
-  gsl_vector_set_zero (calc_data->term);
-  gsl_vector_set_zero (calc_data->weight);
-  gsl_matrix_set_zero (calc_data->einst);
-  gsl_matrix_set_zero (calc_data->freq);
-  gsl_matrix_set_zero (calc_data->coll_rates);
-  gsl_vector_set_zero (calc_data->tot_rates);
-  gsl_matrix_set_zero (calc_data->bgfield);
+  DEBUG ("Updating setup stages %#x of %s", dirty, inp_data->name);
+  calc_data->ready &= ~dirty;
+  calc_data->input = *inp_data;
 
-  for (int i = 0; i < mol_info->numof_enlev; ++i)
+  RXI_STAT status = RXI_OK;
+  if (dirty & RXI_STAGE_MOLECULE)
     {
-      gsl_vector_set (calc_data->term, mol_enlev->level[i] - 1,
-                      mol_enlev->term[i]);
-      gsl_vector_set (calc_data->weight, mol_enlev->level[i] - 1,
-                      mol_enlev->weight[i]);
+      status = rxi_calc_data_load_molecule (calc_data, mol_info);
+      if (status != RXI_OK)
+        return status;
     }
 
-  DEBUG ("Setting Einstein coefs and energies");
+  if (dirty & RXI_STAGE_DENSITIES)
+    update_rates (calc_data, mol_info);
+  if (dirty & RXI_STAGE_TEMP_BG)
+    rxi_calc_data_set_temp_bg (calc_data);
+  if (dirty & RXI_STAGE_PREPARE)
+    rxi_calc_data_prepare (calc_data);
+
+  return status;
+}
+
+RXI_STAT
+rxi_calc_data_init (struct rxi_calc_data *calc_data,
+                    const struct rxi_input_data *inp_data,
+                    const struct rxi_db_molecule_info *mol_info)
+{
+  DEBUG ("Calculation data initialization for %s", inp_data->name);
+
+  // Only tables of the molecule are kept
+  calc_data->ready &= RXI_STAGE_MOLECULE;
+  return rxi_calc_data_update (calc_data, inp_data, mol_info);
+}
+
+// Ng (1974) extrapolation over the last four population vectors stored in
+// the rows of `hist` (oldest first). Writes the extrapolated populations to
+// `pop` and returns `false` without touching it if the iteration is not yet
+// contracting or the result is unusable. Levels with populations below
+// `min_pop` are dominated by round-off, so they are neither used for the
+// coefficients nor extrapolated.
+static bool
+ng_extrapolate (const gsl_matrix *hist, gsl_vector *pop)
+{
+  const double min_pop = 1e-10;
+  const size_t n = pop->size;
+  double a11 = 0, a12 = 0, a22 = 0, c1 = 0, c2 = 0;
+  double norm0 = 0, norm1 = 0, norm2 = 0;
+  for (size_t i = 0; i < n; ++i)
+    {
+      const double x0 = gsl_matrix_get (hist, 3, i);
+      const double x1 = gsl_matrix_get (hist, 2, i);
+      const double x2 = gsl_matrix_get (hist, 1, i);
+      const double x3 = gsl_matrix_get (hist, 0, i);
+      if (x0 < min_pop)
+        continue;
+
+      // Relative weighting, so weakly populated levels count as well
+      const double w = 1 / gsl_pow_2 (x0);
+      const double d0 = x0 - x1;
+      const double q1 = d0 - (x1 - x2);
+      const double q2 = d0 - (x2 - x3);
+
+      a11 += w * q1 * q1;
+      a12 += w * q1 * q2;
+      a22 += w * q2 * q2;
+      c1 += w * q1 * d0;
+      c2 += w * q2 * d0;
+
+      norm0 += w * d0 * d0;
+      norm1 += w * gsl_pow_2 (x1 - x2);
+      norm2 += w * gsl_pow_2 (x2 - x3);
+    }
+
+  // Extrapolation is only meaningful in the linear convergence regime
+  if (!(norm0 < norm1 && norm1 < norm2))
+    return false;
+
+  const double det = a11 * a22 - a12 * a12;
+  if (!(fabs (det) > 1e-14 * a11 * a22))
+    return false;
+
+  const double a = (c1 * a22 - c2 * a12) / det;
+  const double b = (c2 * a11 - c1 * a12) / det;
+  if (!isfinite (a) || !isfinite (b))
+    return false;
+
+  for (size_t i = 0; i < n; ++i)
+    {
+      const double x0 = gsl_matrix_get (hist, 3, i);
+      const double new_pop_i = (1 - a - b) * x0
+                               + a * gsl_matrix_get (hist, 2, i)
+                               + b * gsl_matrix_get (hist, 1, i);
+      if (x0 >= min_pop && !(new_pop_i > 0.5 * x0 && new_pop_i < 2 * x0))
+        return false;
+    }
+
+  double total_pop = 0;
+  for (size_t i = 0; i < n; ++i)
+    {
+      double new_pop_i = gsl_matrix_get (hist, 3, i);
+      if (new_pop_i >= min_pop)
+        new_pop_i = (1 - a - b) * new_pop_i
+                    + a * gsl_matrix_get (hist, 2, i)
+                    + b * gsl_matrix_get (hist, 1, i);
+      gsl_vector_set (pop, i, new_pop_i);
+      total_pop += new_pop_i;
+    }
+  gsl_vector_scale (pop, 1 / total_pop);
+
+  return true;
+}
+
+// Writes minus residual of the statistical equilibrium equations for the
+// populations in `data->pop` to `f` and returns its norm. The rate matrix must
+// be assembled for the same populations. Last equation is the normalization
+// of populations, as in the fixed-point solver. Each equation is weighted by
+// the total depopulation rate of its level for the norm, otherwise it is
+// dominated by the fastest transitions.
+static double
+newton_residual (const struct rxi_calc_data *data, gsl_vector *f,
+                 const int n_enlev)
+{
+  double norm = 0;
+  for (int i = 0; i < n_enlev - 1; ++i)
+    {
+      double f_i = 0;
+      for (int j = 0; j < n_enlev; ++j)
+        f_i += gsl_matrix_get (data->rates, i, j)
+               * gsl_vector_get (data->pop, j);
+      gsl_vector_set (f, i, -f_i);
+      norm += gsl_pow_2 (f_i / gsl_matrix_get (data->rates, i, i));
+    }
+
+  double total_pop = 0;
+  for (int i = 0; i < n_enlev; ++i)
+    total_pop += gsl_vector_get (data->pop, i);
+  gsl_vector_set (f, n_enlev - 1, 1 - total_pop);
+  norm += gsl_pow_2 (1 - total_pop);
+
+  return sqrt (norm);
+}
+
+// Turns the rate matrix into the Jacobian of the statistical equilibrium
+// equations. Escape probabilities depend on populations through optical
+// depths, which adds four entries per radiative transition.
+static void
+add_escape_jacobian (struct rxi_calc_data *data, const int n_radtr)
+{
+  for (int i = 0; i < n_radtr; ++i)
+    {
+      const unsigned int u = data->up[i] - 1;
+      const unsigned int l = data->low[i] - 1;
+
+      const double energy = gsl_vector_get (data->term, u)
+                            - gsl_vector_get (data->term, l);
+      const double einst = gsl_vector_get (data->einst, i);
+      const double gu = gsl_vector_get (data->weight, u);
+      const double gl = gsl_vector_get (data->weight, l);
+
+      // Optical depth is linear in populations
+      const double dtau_du = rxi_calc_optical_depth (data->input.col_dens,
+          data->input.line_width, energy, einst, gu, gl, 1, 0);
+      const double dtau_dl = rxi_calc_optical_depth (data->input.col_dens,
+          data->input.line_width, energy, einst, gu, gl, 0, 1);
+      const double dbeta = rxi_calc_escape_prob_deriv (
+          gsl_vector_get (data->tau, i), data->input.geom);
+
+      // Net radiative rate from the upper level divided by escape probability
+      const double occ = gsl_vector_get (data->bgfield, i)
+                         / (2 * RXI_HP * RXI_SOL * gsl_pow_3 (energy));
+      const double flow = einst
+                          * ((1 + occ) * gsl_vector_get (data->pop, u)
+                             - gu / gl * occ * gsl_vector_get (data->pop, l));
+
+      *gsl_matrix_ptr (data->rates, u, u) += dbeta * flow * dtau_du;
+      *gsl_matrix_ptr (data->rates, u, l) += dbeta * flow * dtau_dl;
+      *gsl_matrix_ptr (data->rates, l, u) -= dbeta * flow * dtau_du;
+      *gsl_matrix_ptr (data->rates, l, l) -= dbeta * flow * dtau_dl;
+    }
+}
+
+// Newton-Raphson iteration on the statistical equilibrium equations starting
+// from the populations in `data->pop`, which should be close to the solution.
+// Steps are limited to change populations by a factor of three at most and
+// backtracked until the residual decreases. Returns `false` if the iteration
+// did not converge; populations are left in an undefined state.
+static bool
+find_rates_newton (struct rxi_calc_data *data, struct rxi_calc_workspace *work,
+                   const int n_enlev, const int n_radtr, unsigned int *iter)
+{
+  const double min_pop = 1e-10;
+  const double max_factor = 3;
+  gsl_vector *f = work->b;
+  gsl_vector *step = work->x;
+  gsl_vector *prev_pop = work->prev_pop;
+
+  refresh_starting_conditions (data, n_radtr);
+  double norm = newton_residual (data, f, n_enlev);
+
+  for (*iter = 0; *iter < 30; ++*iter)
+    {
+      add_escape_jacobian (data, n_radtr);
+      gsl_vector_set_all (step, 1);
+      gsl_matrix_set_row (data->rates, n_enlev - 1, step);
+      rxi_linalg_LU_decomp (data->input.solver.lu_backend, data->rates,
+                            work->perm);
+      gsl_linalg_LU_solve (data->rates, work->perm, f, step);
+
+      // Largest step that changes no population by more than `max_factor`.
+      // Populations below `min_pop` may change by as much as `min_pop`
+      // itself, or a level with a negligible population would hold back the
+      // steps of the whole system.
+      double lambda = 1;
+      double max_change = 0;
+      for (int i = 0; i < n_enlev; ++i)
+        {
+          const double pop_i = gsl_vector_get (data->pop, i);
+          const double step_i = gsl_vector_get (step, i);
+          const double scale = fmax (pop_i, min_pop);
+
+          if (lambda * step_i < -(1 - 1 / max_factor) * scale)
+            lambda = -(1 - 1 / max_factor) * scale / step_i;
+          if (lambda * step_i > (max_factor - 1) * scale)
+            lambda = (max_factor - 1) * scale / step_i;
+          if (pop_i >= min_pop)
+            max_change = fmax (max_change, fabs (step_i) / pop_i);
+        }
+
+      // Convergence is quadratic, so the error after this step is of order
+      // `max_change` squared and the residual is at round-off level
+      const bool converged = (lambda == 1 && max_change < 1e-6);
+
+      gsl_vector_memcpy (prev_pop, data->pop);
+      double new_norm = 0;
+      for (int k = 0; k < 20; ++k, lambda /= 2)
+        {
+          for (int i = 0; i < n_enlev; ++i)
+            gsl_vector_set (data->pop, i,
+                fabs (gsl_vector_get (prev_pop, i)
+                      + lambda * gsl_vector_get (step, i)));
+
+          refresh_starting_conditions (data, n_radtr);
+          new_norm = newton_residual (data, f, n_enlev);
+          if (converged || new_norm < norm)
+            break;
+        }
+
+      DEBUG ("%u: Newton residual %.3e | step %.3e | damping %.3e", *iter,
+             new_norm, max_change, lambda);
+
+      if (converged)
+        {
+          ++*iter;
+          return true;
+        }
+      if (!isfinite (new_norm) || new_norm >= norm)
+        return false;
+
+      norm = new_norm;
+    }
+
+  return false;
+}
+
+// Restarted GMRES for `a` x = `b`, preconditioned from the left by the LU
+// factors in the workspace and started from the current `x`. Stops when the
+// preconditioned residual drops below `tol` relative to the preconditioned
+// right-hand side, which is close to the relative error of `x`. Returns
+// `false` if that did not happen in two restart cycles. Writes the number of
+// Krylov iterations to `*iters` and the last relative residual to `*resid`.
+static bool
+gmres_solve (const gsl_matrix *a, const gsl_vector *b, gsl_vector *x,
+             struct rxi_calc_workspace *work, const double tol,
+             unsigned int *iters, double *resid)
+{
+  gsl_matrix *krylov = work->krylov;
+  gsl_matrix *h = work->hess;
+  gsl_vector *g = work->lsq_rhs;
+  gsl_vector_view v0 = gsl_matrix_row (krylov, 0);
+
+  gsl_vector_memcpy (&v0.vector, b);
+  gsl_linalg_LU_svx (work->precond, work->precond_perm, &v0.vector);
+  const double b_norm = gsl_blas_dnrm2 (&v0.vector);
+
+  *iters = 0;
+  for (int cycle = 0; cycle < 2; ++cycle)
+    {
+      gsl_vector_memcpy (&v0.vector, b);
+      gsl_blas_dgemv (CblasNoTrans, -1, a, x, 1, &v0.vector);
+      gsl_linalg_LU_svx (work->precond, work->precond_perm, &v0.vector);
+      const double beta = gsl_blas_dnrm2 (&v0.vector);
+      *resid = beta / b_norm;
+      if (*resid <= tol)
+        return true;
+
+      gsl_vector_scale (&v0.vector, 1 / beta);
+      gsl_vector_set_zero (g);
+      gsl_vector_set (g, 0, beta);
+
+      int k = 0;
+      while (k < RXI_GMRES_RESTART)
+        {
+          // Arnoldi step with modified Gram-Schmidt
+          gsl_vector_const_view vk = gsl_matrix_const_row (krylov, k);
+          gsl_vector_view w = gsl_matrix_row (krylov, k + 1);
+          gsl_blas_dgemv (CblasNoTrans, 1, a, &vk.vector, 0, &w.vector);
+          gsl_linalg_LU_svx (work->precond, work->precond_perm, &w.vector);
+          for (int i = 0; i <= k; ++i)
+            {
+              gsl_vector_const_view vi = gsl_matrix_const_row (krylov, i);
+              double h_ik;
+              gsl_blas_ddot (&w.vector, &vi.vector, &h_ik);
+              gsl_blas_daxpy (-h_ik, &vi.vector, &w.vector);
+              gsl_matrix_set (h, i, k, h_ik);
+            }
+          const double h_next = gsl_blas_dnrm2 (&w.vector);
+          if (h_next > 0)
+            gsl_vector_scale (&w.vector, 1 / h_next);
+
+          // Keep the Hessenberg matrix triangular with Givens rotations
+          for (int i = 0; i < k; ++i)
+            {
+              const double c = gsl_vector_get (work->givens_cos, i);
+              const double sn = gsl_vector_get (work->givens_sin, i);
+              const double h0 = gsl_matrix_get (h, i, k);
+              const double h1 = gsl_matrix_get (h, i + 1, k);
+              gsl_matrix_set (h, i, k, c * h0 + sn * h1);
+              gsl_matrix_set (h, i + 1, k, -sn * h0 + c * h1);
+            }
+          const double h_kk = gsl_matrix_get (h, k, k);
+          const double den = hypot (h_kk, h_next);
+          const double c = h_kk / den;
+          const double sn = h_next / den;
+          gsl_vector_set (work->givens_cos, k, c);
+          gsl_vector_set (work->givens_sin, k, sn);
+          gsl_matrix_set (h, k, k, den);
+          gsl_vector_set (g, k + 1, -sn * gsl_vector_get (g, k));
+          gsl_vector_set (g, k, c * gsl_vector_get (g, k));
+
+          ++k;
+          ++*iters;
+          *resid = fabs (gsl_vector_get (g, k)) / b_norm;
+          if (*resid <= tol || h_next == 0)
+            break;
+        }
+
+      // Least squares solution by back substitution, then update `x`
+      for (int i = k - 1; i >= 0; --i)
+        {
+          double y_i = gsl_vector_get (g, i);
+          for (int j = i + 1; j < k; ++j)
+            y_i -= gsl_matrix_get (h, i, j) * gsl_vector_get (g, j);
+          gsl_vector_set (g, i, y_i / gsl_matrix_get (h, i, i));
+        }
+      for (int i = 0; i < k; ++i)
+        {
+          gsl_vector_const_view vi = gsl_matrix_const_row (krylov, i);
+          gsl_blas_daxpy (gsl_vector_get (g, i), &vi.vector, x);
+        }
+
+      if (*resid <= tol)
+        return true;
+    }
+
+  return false;
+}
+
+// Factorizes the rate matrix of the iteration into `work->precond` and keeps
+// terms of lines it was built with, so that later iterations update the
+// factors instead
+static void
+lowrank_factorize (struct rxi_calc_data *data, struct rxi_calc_workspace *work,
+                   const int n_radtr)
+{
+  struct rxi_calc_lowrank *lr = work->lowrank;
+  const double *beta = gsl_vector_const_ptr (data->beta, 0);
+  const double *bgfield = gsl_vector_const_ptr (data->bgfield, 0);
+
+  gsl_matrix_memcpy (work->precond, data->rates);
+  rxi_linalg_LU_decomp (data->input.solver.lu_backend, work->precond,
+                        work->precond_perm);
+  for (int i = 0; i < n_radtr; ++i)
+    {
+      line_terms (&data->lines, beta, bgfield, i, &lr->emission[i],
+                  &lr->absorption[i]);
+      lr->row[i] = SIZE_MAX;
+    }
+  lr->rank = 0;
+  ++lr->numof_factorizations;
+  work->has_precond = true;
+}
+
+// Whether line `i` outside of the update changed enough to join it
+static inline bool
+lowrank_changed (const struct rxi_calc_lowrank *lr, const size_t i,
+                 const double emission, const double absorption)
+{
+  return fabs (emission - lr->emission[i]) > RXI_LOWRANK_TOL * lr->emission[i]
+         || (fabs (absorption - lr->absorption[i])
+             > RXI_LOWRANK_TOL * lr->absorption[i]);
+}
+
+// Adds lines whose terms changed by more than `RXI_LOWRANK_TOL` to the
+// update, solving for their columns of `Z = A^{-1} U` once, and keeps the
+// changes of all lines of the update. Returns `false` without solving if
+// more lines changed than the update can take
+static bool
+lowrank_add_lines (const struct rxi_calc_data *data,
+                   struct rxi_calc_workspace *work, const int n_radtr)
+{
+  struct rxi_calc_lowrank *lr = work->lowrank;
+  const size_t n = work->numof_enlev;
+  const double *beta = gsl_vector_const_ptr (data->beta, 0);
+  const double *bgfield = gsl_vector_const_ptr (data->bgfield, 0);
+
+  size_t rank = lr->rank;
+  for (int i = 0; i < n_radtr; ++i)
+    {
+      double emission, absorption;
+      line_terms (&data->lines, beta, bgfield, i, &emission, &absorption);
+      if (lr->row[i] == SIZE_MAX
+          && lowrank_changed (lr, i, emission, absorption))
+        ++rank;
+    }
+  if (rank > lr->max_rank)
+    return false;
+
+  for (int i = 0; i < n_radtr; ++i)
+    {
+      double emission, absorption;
+      line_terms (&data->lines, beta, bgfield, i, &emission, &absorption);
+      if (lr->row[i] == SIZE_MAX)
+        {
+          if (!lowrank_changed (lr, i, emission, absorption))
+            continue;
+
+          // `U` of the line without the last row, which is replaced by the
+          // normalization of populations
+          double *z = lr->z + lr->rank * n;
+          memset (z, 0, n * sizeof (*z));
+          z[data->lines.up[i]] = 1;
+          z[data->lines.low[i]] = -1;
+          z[n - 1] = 0;
+          gsl_vector_view z_view = gsl_vector_view_array (z, n);
+          gsl_linalg_LU_svx (work->precond, work->precond_perm,
+                             &z_view.vector);
+          lr->line[lr->rank] = i;
+          lr->row[i] = lr->rank++;
+        }
+      lr->d_emission[lr->row[i]] = emission - lr->emission[i];
+      lr->d_absorption[lr->row[i]] = absorption - lr->absorption[i];
+    }
+
+  return true;
+}
+
+// Factorizes the capacitance matrix `I + V^T Z` of the update. Row `p` of
+// `V^T` holds the change of emission of line `p` in the column of its upper
+// level and minus the change of absorption in the column of its lower one.
+// Returns `false` if the matrix is singular
+static bool
+lowrank_factorize_cap (const struct rxi_calc_lines *lines,
+                       struct rxi_calc_lowrank *lr)
+{
+  const size_t n = lr->numof_enlev;
+  const size_t k = lr->rank;
+  for (size_t p = 0; p < k; ++p)
+    {
+      const size_t u = lines->up[lr->line[p]];
+      const size_t l = lines->low[lr->line[p]];
+      for (size_t q = 0; q < k; ++q)
+        {
+          const double *z = lr->z + q * n;
+          lr->cap[p * k + q] = (p == q)
+                               + lr->d_emission[p] * z[u]
+                               - lr->d_absorption[p] * z[l];
+        }
+    }
+
+  gsl_matrix_view cap = gsl_matrix_view_array (lr->cap, k, k);
+  gsl_permutation perm = { k, lr->cap_perm };
+  int signum;
+  gsl_linalg_LU_decomp (&cap.matrix, &perm, &signum);
+  for (size_t p = 0; p < k; ++p)
+    {
+      const double pivot = lr->cap[p * k + p];
+      if (pivot == 0 || !isfinite (pivot))
+        return false;
+    }
+
+  return true;
+}
+
+// Factors of the rate matrix with a low-rank update for
+// `rxi_linalg_refine_with()`
+struct lowrank_solver
+{
+  const struct rxi_calc_lines *lines;
+  struct rxi_calc_workspace *work;
+};
+
+// Solves with the updated factors in place by the Woodbury formula
+// `(A + U V^T)^{-1} v = A^{-1} v - Z C^{-1} V^T A^{-1} v`
+static void
+lowrank_svx (void *ctx, gsl_vector *v)
+{
+  const struct lowrank_solver *solver = ctx;
+  struct rxi_calc_workspace *work = solver->work;
+  struct rxi_calc_lowrank *lr = work->lowrank;
+  const size_t n = lr->numof_enlev;
+  const size_t k = lr->rank;
+
+  gsl_linalg_LU_svx (work->precond, work->precond_perm, v);
+  if (k == 0)
+    return;
+
+  for (size_t p = 0; p < k; ++p)
+    {
+      const size_t line = lr->line[p];
+      lr->cap_rhs[p] = lr->d_emission[p]
+                       * gsl_vector_get (v, solver->lines->up[line])
+                       - lr->d_absorption[p]
+                       * gsl_vector_get (v, solver->lines->low[line]);
+    }
+  gsl_matrix_const_view cap = gsl_matrix_const_view_array (lr->cap, k, k);
+  gsl_permutation perm = { k, lr->cap_perm };
+  gsl_vector_view rhs = gsl_vector_view_array (lr->cap_rhs, k);
+  gsl_linalg_LU_svx (&cap.matrix, &perm, &rhs.vector);
+
+  for (size_t p = 0; p < k; ++p)
+    {
+      gsl_vector_const_view z = gsl_vector_const_view_array (lr->z + p * n, n);
+      gsl_blas_daxpy (-lr->cap_rhs[p], &z.vector, v);
+    }
+}
+
+// Solves `data->rates` x = b with factors of an earlier iteration: lines
+// whose terms changed since then are applied to the factors as a low-rank
+// update, and the solution is refined with the rate matrix itself, which
+// also corrects for the small changes left out of the update. The matrix is
+// factorized again when too many lines changed or refinement fails
+static void
+solve_lowrank (struct rxi_calc_data *data, struct rxi_calc_workspace *work,
+               const int n_radtr)
+{
+  if (work->lowrank && work->lowrank->numof_radtr != (size_t) n_radtr)
+    {
+      rxi_calc_lowrank_free (work->lowrank);
+      work->lowrank = NULL;
+    }
+  if (!work->lowrank)
+    {
+      const size_t max_rank = work->numof_enlev / RXI_LOWRANK_RATIO + 1;
+      if (rxi_calc_lowrank_malloc (&work->lowrank, work->numof_enlev,
+                                   n_radtr, max_rank) != RXI_OK)
+        {
+          rxi_linalg_LU_decomp (data->input.solver.lu_backend, data->rates,
+                                work->perm);
+          gsl_linalg_LU_solve (data->rates, work->perm, work->b, work->x);
+          return;
+        }
+      work->has_precond = false;
+    }
+
+  struct rxi_calc_lowrank *lr = work->lowrank;
+  if (work->has_precond && lowrank_add_lines (data, work, n_radtr)
+      && (lr->rank == 0 || lowrank_factorize_cap (&data->lines, lr)))
+    {
+      struct lowrank_solver solver = { &data->lines, work };
+      unsigned int steps = 0;
+      if (rxi_linalg_refine_with (data->rates, lowrank_svx, &solver, work->b,
+                                  work->x, work->resid, &steps))
+        {
+          DEBUG ("Low-rank update: %zu lines, %u refinement steps",
+                 lr->rank, steps);
+          ++lr->numof_updates;
+          return;
+        }
+    }
+
+  DEBUG ("Low-rank update: new factors");
+  lowrank_factorize (data, work, n_radtr);
+  gsl_linalg_LU_solve (work->precond, work->precond_perm, work->b, work->x);
+}
+
+// Solves `data->rates` x = b for the workspace vectors with the linear
+// solver chosen in the input; LU decomposition destroys the rate matrix.
+// GMRES is preconditioned by the LU factors of the rate matrix from an
+// earlier iteration: only escape probabilities change between iterations,
+// so a few Krylov iterations replace a new decomposition. Factors are
+// renewed when GMRES fails or needs many iterations. Mixed precision solves
+// factorize the equilibrated matrix in single precision and refine the
+// solution to double precision with residuals of the original one. Low-rank
+// solves update factors of an earlier iteration for lines whose terms
+// changed; terms of the optically thin start (`thin`) aren't those of
+// `line_terms()`, so it is solved by LU.
+static void
+solve_rate_equations (struct rxi_calc_data *data,
+                      struct rxi_calc_workspace *work, const int n_radtr,
+                      const bool thin)
+{
+  if (data->input.solver.linear_solver == LS_LOWRANK)
+    {
+      if (!thin)
+        {
+          solve_lowrank (data, work, n_radtr);
+          return;
+        }
+      work->has_precond = false;
+    }
+
+  if (data->input.solver.linear_solver == LS_GMRES)
+    {
+      unsigned int iters = 0;
+      double resid = 0;
+      if (work->has_precond
+          && gmres_solve (data->rates, work->b, work->x, work, 1e-15, &iters,
+                          &resid))
+        {
+          DEBUG ("GMRES: %u iterations, residual %.3e", iters, resid);
+          data->linear_residual = fmax (data->linear_residual, resid);
+          if (iters > RXI_GMRES_RESTART / 2)
+            work->has_precond = false;
+          return;
+        }
+
+      DEBUG ("GMRES: new preconditioner (%u iterations, residual %.3e)",
+             iters, resid);
+      gsl_matrix_memcpy (work->precond, data->rates);
+      rxi_linalg_LU_decomp (data->input.solver.lu_backend, work->precond,
+                            work->precond_perm);
+      gsl_linalg_LU_solve (work->precond, work->precond_perm, work->b,
+                           work->x);
+      work->has_precond = true;
+      return;
+    }
+
+  // Equilibrated system `(R A C) y = R b`, the solution is `x = C y`
+  const bool equilibrate = data->input.solver.equilibrate
+                           || data->input.solver.linear_solver == LS_MIXED;
+  if (equilibrate)
+    {
+      rxi_linalg_equilibrate (data->rates, work->row_scale, work->col_scale);
+      gsl_vector_mul (work->b, work->row_scale);
+    }
+
+  bool solved = false;
+  if (data->input.solver.linear_solver == LS_MIXED)
+    {
+      const size_t n = work->numof_enlev;
+      for (size_t i = 0; i < n; ++i)
+        {
+          const double *row = gsl_matrix_const_ptr (data->rates, i, 0);
+          for (size_t j = 0; j < n; ++j)
+            work->rates_float[i * n + j] = row[j];
+        }
+      rxi_linalg_LU_decomp_float (n, work->rates_float, work->perm);
+
+      unsigned int steps = 0;
+      solved = rxi_linalg_refine (data->rates, work->rates_float, work->perm,
+                                  work->b, work->x, work->resid, &steps);
+      DEBUG ("Iterative refinement: %u steps%s", steps,
+             solved ? "" : ", failed");
+    }
+
+  // Double precision LU; also the fallback when refinement fails
+  if (!solved)
+    {
+      rxi_linalg_LU_decomp (data->input.solver.lu_backend, data->rates,
+                            work->perm);
+      gsl_linalg_LU_solve (data->rates, work->perm, work->b, work->x);
+    }
+
+  if (equilibrate)
+    gsl_vector_mul (work->x, work->col_scale);
+}
+
+// Excitation temperature of radiative transition `i` for current populations
+static double
+line_excit_temp (const struct rxi_calc_data *data, const int i)
+{
+  const unsigned int u = data->up[i] - 1;
+  const unsigned int l = data->low[i] - 1;
+
+  return RXI_FK
+      * (gsl_vector_get (data->term, u) - gsl_vector_get (data->term, l))
+      / log (gsl_vector_get (data->pop, l)
+             * gsl_vector_get (data->weight, u)
+             / gsl_vector_get (data->pop, u)
+             / gsl_vector_get (data->weight, l));
+}
+
+// Under-relaxed fixed-point iteration of RADEX. Iterates until the relative
+// change of excitation temperatures of optically thick lines drops below
+// `tolerance` and returns the number of iterations. Starts from `start_pop`
+// or from the optically thin solution if it is `NULL`.
+static unsigned int
+find_rates_fixed_point (struct rxi_calc_data *data,
+                        struct rxi_calc_workspace *work, const int n_enlev,
+                        const int n_radtr, const gsl_vector *start_pop,
+                        const double tolerance)
+{
+  unsigned int iter = 0;
+  int thick_lines = 1;
+  double stop_condition = 0;
+  gsl_vector *prev_pop = work->prev_pop;
+  gsl_vector_set_zero (prev_pop);
+
+  if (start_pop)
+    {
+      gsl_vector_memcpy (data->pop, start_pop);
+      for (int i = 0; i < n_radtr; ++i)
+        gsl_vector_set (data->excit_temp, i, line_excit_temp (data, i));
+    }
+
+  // Ng acceleration state
+  bool ng_accel = data->input.solver.ng_accel;
+  bool ng_pending = false;
+  int ng_count = 0;
+  int ng_rejects = 0;
+  double residual = 0;
+  double prev_residual = 0;
+
+  // Weights of new populations and excitation temperatures; they keep the
+  // ratio of RADEX's 0.3 and 0.5 when adapted. Ng extrapolation assumes the
+  // same iteration on every step, so weights are fixed with it
+  const bool adaptive = data->input.solver.adaptive_relax && !ng_accel;
+  double relax = RXI_RELAX;
+  double relax_max = 1;
+  double relax_residual = 0;
+
+  // Between full sweeps only lines of `data->active` are updated. The first
+  // iteration is a full sweep, and the iteration stops only after an
+  // iteration which updated every line, so all of them are checked for
+  // convergence
+  const bool freeze = data->input.solver.freeze_lines;
+  bool sweep_pending = false;
+  bool converged = false;
+  do
+    {
+      const bool thin_start = (iter == 0 && !start_pop);
+      const bool full_sweep = (!freeze || sweep_pending
+                               || iter % RXI_FREEZE_SWEEP == 0);
+      sweep_pending = false;
+      if (thin_start)
+        set_starting_conditions(data, n_radtr);
+      else if (full_sweep)
+        thick_lines = refresh_starting_conditions (data, n_radtr);
+      else
+        thick_lines = refresh_active_lines (data, n_radtr);
+
+      stop_condition = 0;
+
+      // Prepare for calculations
+      gsl_vector *b = work->b;
+      gsl_vector_set_all (b, 1);
+      gsl_matrix_set_row (data->rates, data->rates->size1 - 1, b);
+      gsl_vector_set_all (b, 0);
+      gsl_vector_set (b, b->size - 1, 1);
+      gsl_vector *x = work->x;
+
+      solve_rate_equations (data, work, n_radtr, thin_start);
+
+      double total_pop = 0;
+      for (int i = 0; i < n_enlev; ++i)
+        total_pop += gsl_vector_get (x, i);
+
+      gsl_vector_memcpy (prev_pop, data->pop);
+      for (int i = 0; i < n_enlev; ++i)
+        {
+          const double new_pop_i = gsl_vector_get (x, i) / total_pop;
+          gsl_vector_set (data->pop, i, fabs (new_pop_i));
+        }
+
+      if (thin_start)
+        gsl_vector_memcpy (prev_pop, data->pop);
+
+      if (ng_accel || adaptive)
+        {
+          residual = 0;
+          for (int i = 0; i < n_enlev; ++i)
+            residual += fabs (gsl_vector_get (data->pop, i)
+                              - gsl_vector_get (prev_pop, i));
+        }
+
+      // Residual-ratio heuristic: damped steps which shrink the residual
+      // at least half as fast as the damping allows mean the iteration can
+      // take larger steps. A growing residual means overshooting; weights
+      // above RADEX's one which overshot are not tried again, so that thick
+      // models don't oscillate between large and small steps
+      if (adaptive && !thin_start)
+        {
+          if (relax_residual > 0)
+            {
+              const double ratio = residual / relax_residual;
+              if (ratio > 1)
+                {
+                  if (relax > RXI_RELAX)
+                    relax_max = fmax (0.5 * relax, RXI_RELAX);
+                  relax = fmax (0.5 * relax, RXI_RELAX_MIN);
+                }
+              else if (ratio < 1 - 0.5 * relax)
+                relax = fmin (2 * relax, relax_max);
+            }
+          relax_residual = residual;
+        }
+
+      if (ng_accel)
+        {
+          // Extrapolated populations made things worse: throw this solution
+          // away and continue with plain relaxation from the saved point
+          if (ng_pending && residual > prev_residual)
+            {
+              DEBUG ("Ng extrapolation rejected: %.3e > %.3e", residual,
+                     prev_residual);
+              gsl_vector_memcpy (data->pop, work->ng_backup);
+              gsl_vector_memcpy (prev_pop, work->ng_backup);
+              residual = prev_residual;
+              if (++ng_rejects >= 3)
+                ng_accel = false;
+            }
+          ng_pending = false;
+          prev_residual = residual;
+        }
+
+      const size_t n_lines = full_sweep ? (size_t) n_radtr
+                                        : data->numof_active;
+      size_t n_active = 0;
+      for (size_t k = 0; k < n_lines; ++k)
+        {
+          const size_t i = full_sweep ? k : data->active[k];
+          const unsigned int u = data->up[i] - 1;
+          const unsigned int l = data->low[i] - 1;
+
+          const double new_excit_temp_i = line_excit_temp (data, i);
+          const double excit_temp_i = gsl_vector_get (data->excit_temp, i);
+
+          // Convergence is judged by the change of RADEX's average whatever
+          // the weight of the new temperature is
+          double average = 0.5 * (new_excit_temp_i + excit_temp_i);
+          if (thin_start)
+            {
+              gsl_vector_set (data->excit_temp, i, new_excit_temp_i);
+              average = new_excit_temp_i;
+              stop_condition = 1;
+            }
+          else if (adaptive)
+            {
+              const double weight = fmin (relax * 0.5 / RXI_RELAX, 1);
+              gsl_vector_set (data->excit_temp, i, excit_temp_i
+                  + weight * (new_excit_temp_i - excit_temp_i));
+            }
+          else
+            {
+              gsl_vector_set (data->excit_temp, i, average);
+            }
+          const double new_tau = rxi_calc_optical_depth (data->input.col_dens,
+              data->input.line_width,
+              gsl_vector_get (data->term, u) - gsl_vector_get (data->term, l),
+              gsl_vector_get (data->einst, i),
+              gsl_vector_get (data->weight, u), gsl_vector_get (data->weight, l),
+              gsl_vector_get (data->pop, u), gsl_vector_get (data->pop, l));
+
+          const double excit_change = fabs ((average - new_excit_temp_i)
+                                            / new_excit_temp_i);
+          if (new_tau > 0.01)
+            stop_condition += excit_change;
+
+          // Thin lines whose optical depth and excitation temperature
+          // stopped changing are frozen
+          if (freeze
+              && (thin_start || new_tau > 0.01 || !(excit_change < tolerance)
+                  || !(fabs (new_tau - gsl_vector_get (data->tau, i))
+                       < tolerance)))
+            data->active[n_active++] = i;
+
+          gsl_vector_set (data->tau, i, new_tau);
+        }
+      data->numof_active = n_active;
+
+      for (int i = 0; i < n_enlev; ++i)
+        {
+          const double new_pop_i =
+                      relax * gsl_vector_get (data->pop, i) +
+                      (1 - relax) * gsl_vector_get (prev_pop, i);
+          gsl_vector_set (data->pop, i, new_pop_i);
+        }
+
+      if (ng_accel && !thin_start)
+        {
+          gsl_vector_view row = gsl_matrix_row (work->ng_hist, ng_count);
+          gsl_vector_memcpy (&row.vector, data->pop);
+          if (++ng_count == RXI_NG_HISTORY)
+            {
+              ng_count = 0;
+              gsl_vector_memcpy (work->ng_backup, data->pop);
+              ng_pending = ng_extrapolate (work->ng_hist, data->pop);
+              DEBUG ("Ng extrapolation %s", ng_pending ? "applied" : "skipped");
+            }
+        }
+
+      ++iter;
+      DEBUG ("%d: Thick lines: %d | Stopping cond: %.3e | Relaxation: %.3f",
+             iter, thick_lines, stop_condition, relax);
+      if (freeze)
+        DEBUG ("%zu of %d lines updated", n_lines, n_radtr);
+
+      converged = !(thick_lines != 0
+                    && stop_condition / thick_lines >= tolerance);
+      if (converged && n_lines < (size_t) n_radtr)
+        {
+          sweep_pending = true;
+          converged = false;
+        }
+    } while (!converged && iter < 300);
+
+  data->relax = relax;
+  return iter;
+}
+
+// Whether densities of partners are far above critical densities of all
+// levels: radiative rates out of every level are below `RXI_LTE_RATIO` of
+// collisional ones in `tot_rates`. Rates are taken for escape probabilities
+// of one, the largest they can be
+static bool
+is_lte (const struct rxi_calc_data *data, struct rxi_calc_workspace *work,
+        const int n_enlev, const int n_radtr)
+{
+  const struct rxi_calc_lines *lines = &data->lines;
+  const double *bgfield = gsl_vector_const_ptr (data->bgfield, 0);
+  const double *tot = gsl_vector_const_ptr (data->tot_rates, 0);
+  double *rad = gsl_vector_ptr (work->b, 0);
+
+  gsl_vector_set_zero (work->b);
+  for (int i = 0; i < n_radtr; ++i)
+    {
+      const double coef = bgfield[i] / lines->occ_norm[i];
+      rad[lines->up[i]] += lines->einst[i] * (1 + coef);
+      rad[lines->low[i]] += lines->einst[i] * lines->weight_ratio[i] * coef;
+    }
+
+  for (int i = 0; i < n_enlev; ++i)
+    if (!(rad[i] < RXI_LTE_RATIO * tot[i]))
+      return false;
+
+  return true;
+}
+
+// Whether every line stays thinner than `RXI_THIN_TAU` whatever the
+// populations are: the optical depth is the largest with all molecules on
+// the lower level of the line
+static bool
+is_thin (const struct rxi_calc_data *data, const int n_radtr)
+{
+  const struct rxi_calc_lines *lines = &data->lines;
+  const double *weight = gsl_vector_const_ptr (data->weight, 0);
+  for (int i = 0; i < n_radtr; ++i)
+    {
+      const double tau = rxi_calc_optical_depth (data->input.col_dens,
+          data->input.line_width, lines->energy[i], lines->einst[i],
+          weight[lines->up[i]], weight[lines->low[i]], 0, 1);
+      if (!(tau < RXI_THIN_TAU))
+        return false;
+    }
+
+  return true;
+}
+
+// Fills optical depths, escape probabilities and excitation temperatures of
+// lines for the populations of a fast path; all lines are at the kinetic
+// temperature in LTE
+static void
+fast_path_lines (struct rxi_calc_data *data, const int n_radtr)
+{
+  const struct rxi_calc_lines *lines = &data->lines;
+  const double *weight = gsl_vector_const_ptr (data->weight, 0);
+  const double *pop = gsl_vector_const_ptr (data->pop, 0);
+  for (int i = 0; i < n_radtr; ++i)
+    {
+      const size_t u = lines->up[i];
+      const size_t l = lines->low[i];
+      gsl_vector_set (data->tau, i, rxi_calc_optical_depth (
+          data->input.col_dens, data->input.line_width, lines->energy[i],
+          lines->einst[i], weight[u], weight[l], pop[u], pop[l]));
+      gsl_vector_set (data->excit_temp, i, data->fast_path == FP_LTE
+                      ? data->input.temp_kin : line_excit_temp (data, i));
+    }
+
+  // LTE has none, and the thin path solved with ones
+  escape_probs (data, n_radtr);
+}
+
+// Finds populations without the iteration if the model is in LTE or
+// optically thin (see `is_lte()` and `is_thin()`). LTE populations are
+// Boltzmann ones at the kinetic temperature; thin ones are solved once with
+// escape probabilities of one. Sets `data->fast_path` and returns the number
+// of linear solves
+static unsigned int
+find_rates_fast (struct rxi_calc_data *data, struct rxi_calc_workspace *work,
+                 const int n_enlev, const int n_radtr)
+{
+  unsigned int solves = 0;
+  if (is_lte (data, work, n_enlev, n_radtr))
+    {
+      const double *term = gsl_vector_const_ptr (data->term, 0);
+      const double *weight = gsl_vector_const_ptr (data->weight, 0);
+      double *pop = gsl_vector_ptr (data->pop, 0);
+      double total_pop = 0;
+      for (int i = 0; i < n_enlev; ++i)
+        {
+          pop[i] = weight[i] * exp (-RXI_FK * (term[i] - term[0])
+                                    / data->input.temp_kin);
+          total_pop += pop[i];
+        }
+      gsl_vector_scale (data->pop, 1 / total_pop);
+      data->fast_path = FP_LTE;
+    }
+  else if (is_thin (data, n_radtr))
+    {
+      gsl_vector_set_all (data->beta, 1);
+      assemble_rates (data, n_radtr, false);
+      gsl_vector *b = work->b;
+      gsl_vector_set_all (b, 1);
+      gsl_matrix_set_row (data->rates, data->rates->size1 - 1, b);
+      gsl_vector_set_all (b, 0);
+      gsl_vector_set (b, b->size - 1, 1);
+      solve_rate_equations (data, work, n_radtr, false);
+      solves = 1;
+
+      double total_pop = 0;
+      for (int i = 0; i < n_enlev; ++i)
+        total_pop += gsl_vector_get (work->x, i);
+      for (int i = 0; i < n_enlev; ++i)
+        gsl_vector_set (data->pop, i,
+                        fabs (gsl_vector_get (work->x, i) / total_pop));
+      data->fast_path = FP_THIN;
+    }
+  else
+    {
+      data->fast_path = FP_NONE;
+      return 0;
+    }
+
+  DEBUG ("Fast path: %s", data->fast_path == FP_LTE ? "LTE" : "thin");
+  fast_path_lines (data, n_radtr);
+
+  return solves;
+}
+
+// Fixed-point iteration, and Newton steps if they are chosen, from
+// `start_pop` or from the optically thin solution if it is `NULL`. Returns
+// the number of iterations
+static unsigned int
+find_rates_iterative (struct rxi_calc_data *data,
+                      struct rxi_calc_workspace *work, const int n_enlev,
+                      const int n_radtr, const gsl_vector *start_pop)
+{
+  const struct rxi_solver_opts *opts = &data->input.solver;
+
+  // Newton only polishes the solution, so fixed-point iteration brings
+  // populations close to the same solution as RADEX first
+  const bool newton = (opts->method == SM_NEWTON);
+  unsigned int iter = find_rates_fixed_point (data, work, n_enlev, n_radtr,
+                                              start_pop, newton ? 1e-2 : 1e-7);
+
+  if (newton)
+    {
+      unsigned int newton_iter = 0;
+      const bool converged = find_rates_newton (data, work, n_enlev, n_radtr,
+                                                &newton_iter);
+      iter += newton_iter;
+      if (converged)
+        {
+          for (int i = 0; i < n_radtr; ++i)
+            gsl_vector_set (data->excit_temp, i, line_excit_temp (data, i));
+          DEBUG ("Newton converged after %u iterations", newton_iter);
+        }
+      else
+        {
+          DEBUG ("Newton failed after %u iterations; fall back to fixed point",
+                 newton_iter);
+          ++data->numof_fallbacks;
+          iter += find_rates_fixed_point (data, work, n_enlev, n_radtr, NULL,
+                                          1e-7);
+        }
+    }
+
+  return iter;
+}
+
+#ifdef RXI_CHECK_FAST_PATHS
+// Solves the model again by the iteration started from populations of the
+// fast path and aborts if they moved by more than `RXI_FAST_CHECK_TOL`.
+// Results of the fast path are restored afterwards
+static void
+check_fast_path (struct rxi_calc_data *data, struct rxi_calc_workspace *work,
+                 const int n_enlev, const int n_radtr)
+{
+  const FAST_PATH path = data->fast_path;
+  gsl_vector *fast_pop = gsl_vector_alloc (n_enlev);
+  if (!fast_pop)
+    abort ();
+  gsl_vector_memcpy (fast_pop, data->pop);
+
+  const unsigned int iter = find_rates_iterative (data, work, n_enlev,
+                                                  n_radtr, fast_pop);
+  double diff_max = 0;
+  for (int i = 0; i < n_enlev; ++i)
+    {
+      const double pop = gsl_vector_get (data->pop, i);
+      if (pop > 1e-8)
+        diff_max = fmax (diff_max,
+                         fabs (gsl_vector_get (fast_pop, i) - pop) / pop);
+    }
+  if (!(diff_max < RXI_FAST_CHECK_TOL))
+    {
+      fprintf (stderr, "Fast path `%s' differs from the iteration by %.3e "
+               "after %u iterations\n", path == FP_LTE ? "LTE" : "thin",
+               diff_max, iter);
+      abort ();
+    }
+
+  gsl_vector_memcpy (data->pop, fast_pop);
+  gsl_vector_free (fast_pop);
+  data->fast_path = path;
+  fast_path_lines (data, n_radtr);
+}
+#endif
+
+// Solves statistical equilibrium for all levels of `data`
+static void
+find_rates_all (struct rxi_calc_data *data, struct rxi_calc_workspace *work,
+                const int n_enlev, const int n_radtr)
+{
+  ASSERT ((work->numof_enlev == (size_t) n_enlev) && "Workspace size mismatch");
+
+  const struct rxi_solver_opts *opts = &data->input.solver;
+  data->linear_residual = 0;
+  data->relax = 0;
+  data->numof_fallbacks = 0;
+  // Preconditioner from a neighbouring model is still good for warm starts;
+  // low-rank updates are only made to factors of the same model
+  if (!opts->warm_start || opts->linear_solver == LS_LOWRANK)
+    work->has_precond = false;
+
+  const gsl_vector *start_pop = NULL;
+  if (opts->warm_start && work->has_warm_pop)
+    start_pop = work->warm_pop;
+
+  unsigned int iter = 0;
+  data->fast_path = FP_NONE;
+  if (opts->fast_paths)
+    iter = find_rates_fast (data, work, n_enlev, n_radtr);
+  if (data->fast_path == FP_NONE)
+    iter = find_rates_iterative (data, work, n_enlev, n_radtr, start_pop);
+#ifdef RXI_CHECK_FAST_PATHS
+  else
+    check_fast_path (data, work, n_enlev, n_radtr);
+#endif
 
-  for (int i = 0; i < mol_info->numof_radtr; ++i)
+  if (opts->warm_start)
     {
-      calc_data->up[i] = mol_radtr->up[i];
-      calc_data->low[i] = mol_radtr->low[i];
-      gsl_matrix_set (calc_data->einst, mol_radtr->up[i] - 1,
-                      mol_radtr->low[i] - 1, mol_radtr->einst[i]);
-      gsl_matrix_set (calc_data->freq, mol_radtr->up[i] - 1,
-                      mol_radtr->low[i] - 1, mol_radtr->freq[i]);
+      gsl_vector_memcpy (work->warm_pop, data->pop);
+      work->has_warm_pop = true;
     }
 
-  DEBUG ("Setting collision rates");
+  data->numof_iter = iter;
+  DEBUG ("Finished after %u iterations", iter);
 
-  for (int p = 0; p < inp_data->n_coll_partners; ++p)
-    {
-      // Get index number (from .info file) of entered collisional partner
-      int8_t cp = cptonum (mol_info, inp_data->coll_part[p]);
+  rxi_calc_results (data, n_radtr);
+}
 
-      // Collisional coefficients will be written here
-      gsl_matrix *coll_coef = gsl_matrix_calloc (
-          mol_info->numof_enlev, mol_info->numof_enlev);
+// Number of the lowest levels solved for with truncation `factor`: all
+// levels up to the last one below the energy cut, so that files with levels
+// not sorted by energy lose nothing below the cut. At least two levels are
+// kept to have a line.
+static size_t
+truncated_levels (const struct rxi_calc_data *data, const double factor)
+{
+  const double cut = factor * fmax (data->input.temp_kin,
+                                    data->input.temp_bg);
+  size_t n_keep = 2;
+  for (size_t i = 0; i < data->numof_enlev; ++i)
+    {
+      if (RXI_FK * gsl_vector_get (data->term, i) <= cut && i + 1 > n_keep)
+        n_keep = i + 1;
+    }
 
-      // Set collisional coefficients for current partner
-      double *temps_line = get_matrix_row (mol_info->coll_temps, cp);
-      for (int i = 0; i < mol_info->numof_coll_trans[cp]; ++i)
-        {
-          double *rates_line = get_matrix_row (mol_cp[p]->coll_rates, i);
-          double coef = interpolate_cp_rate (inp_data->temp_kin,
-              temps_line, rates_line, mol_info->numof_coll_temps[cp]);
-          gsl_matrix_set (coll_coef, mol_cp[p]->up[i] - 1,
-                          mol_cp[p]->low[i] - 1, coef);
+  return (n_keep < data->numof_enlev) ? n_keep : data->numof_enlev;
+}
 
-          free (rates_line);
-        }
-      free (temps_line);
+static bool
+is_truncated_line (const struct rxi_calc_data *data, const size_t i,
+                   const size_t n_keep)
+{
+  return ((size_t) data->up[i] > n_keep) || ((size_t) data->low[i] > n_keep);
+}
 
-      // And here coefficients become collisional rates (but not final ones)
-      gsl_matrix_scale (coll_coef, inp_data->coll_part_dens[p]);
-      gsl_matrix_add (calc_data->coll_rates, coll_coef);
+// Copies levels and lines of `data` within the lowest `sub->numof_enlev`
+// levels to `sub`, as if the molecule had no other levels
+static void
+truncate_data (const struct rxi_calc_data *data, struct rxi_calc_data *sub)
+{
+  const size_t n = sub->numof_enlev;
 
-      gsl_matrix_free (coll_coef);
+  sub->input = data->input;
+  for (size_t i = 0; i < n; ++i)
+    {
+      gsl_vector_set (sub->term, i, gsl_vector_get (data->term, i));
+      gsl_vector_set (sub->weight, i, gsl_vector_get (data->weight, i));
     }
 
-  // Cannot do this with common gsl matrix operations
-  for (int i = 0; i < mol_info->numof_enlev; ++i)
+  size_t k = 0;
+  for (size_t i = 0; i < data->numof_radtr; ++i)
     {
-      for (int j = 0; j < mol_info->numof_enlev; ++j)
-        {
-          gsl_matrix_set (calc_data->rates, i, j, 1e-30);
-          double ediff = gsl_vector_get (calc_data->term, i)
-                         - gsl_vector_get (calc_data->term, j);
-          if (ediff < 0)
-            continue;
-
-          double rate = rxi_calc_crate (gsl_vector_get (calc_data->weight, i),
-              gsl_vector_get (calc_data->weight, j), ediff, inp_data->temp_kin,
-              gsl_matrix_get (calc_data->coll_rates, i, j));
+      if (is_truncated_line (data, i, n))
+        continue;
 
-          gsl_matrix_set (calc_data->coll_rates, j, i, rate);
-        }
+      sub->up[k] = data->up[i];
+      sub->low[k] = data->low[i];
+      gsl_vector_set (sub->einst, k, gsl_vector_get (data->einst, i));
+      gsl_vector_set (sub->freq, k, gsl_vector_get (data->freq, i));
+      gsl_vector_set (sub->bgfield, k, gsl_vector_get (data->bgfield, i));
+      fill_line (sub, k);
+      ++k;
     }
 
-  // Calculate total collisional rates
-  for (int i = 0; i < mol_info->numof_enlev; ++i)
+  gsl_matrix_const_view coll = gsl_matrix_const_submatrix (data->coll_rates,
+                                                           0, 0, n, n);
+  gsl_matrix_memcpy (sub->coll_rates, &coll.matrix);
+
+  // Collisions to levels above the cut are dropped with the levels
+  for (size_t j = 0; j < n; ++j)
     {
-      gsl_vector *conv = gsl_vector_alloc (mol_info->numof_enlev);
-      gsl_matrix_get_col (conv, calc_data->coll_rates, i);
-      gsl_vector_add (calc_data->tot_rates, conv);
-      gsl_vector_free (conv);
+      double tot = 0;
+      for (size_t i = 0; i < n; ++i)
+        tot += gsl_matrix_get (sub->coll_rates, j, i);
+      gsl_vector_set (sub->tot_rates, j, tot);
     }
-
-  gsl_matrix_memcpy (calc_data->rates_archive, calc_data->rates);
-
-  return RXI_OK;
+  fill_rates_archive (sub);
 }
 
-RXI_STAT
-rxi_calc_find_rates (struct rxi_calc_data *data, const int n_enlev,
-                     const int n_radtr)
+// Fills results of `data` from the solution `sub` for its lowest levels.
+// Populations above the cut follow the Boltzmann distribution at the kinetic
+// temperature from the highest solved level, so lines between them are in
+// LTE.
+static void
+untruncate_results (struct rxi_calc_data *data,
+                    const struct rxi_calc_data *sub)
 {
-  unsigned int iter = 0;
-  int thick_lines = 1;
-  double stop_condition = 0;
-  gsl_vector *prev_pop = gsl_vector_calloc (n_enlev);
-  do
+  const size_t n = sub->numof_enlev;
+  const double top_term = gsl_vector_get (data->term, n - 1);
+  const double top_pop = gsl_vector_get (sub->pop, n - 1)
+                         / gsl_vector_get (data->weight, n - 1);
+
+  double total_pop = 0;
+  for (size_t i = 0; i < data->numof_enlev; ++i)
     {
-      if (iter == 0)
-        set_starting_conditions(data, n_radtr);
+      double pop_i = 0;
+      if (i < n)
+        pop_i = gsl_vector_get (sub->pop, i);
       else
-        thick_lines = refresh_starting_conditions (data, n_radtr);
+        pop_i = top_pop * gsl_vector_get (data->weight, i)
+                * exp (-RXI_FK * (gsl_vector_get (data->term, i) - top_term)
+                       / data->input.temp_kin);
+      gsl_vector_set (data->pop, i, pop_i);
+      total_pop += pop_i;
+    }
+  gsl_vector_scale (data->pop, 1 / total_pop);
 
-      stop_condition = 0;
-      // Correct rates for collisional rates and prepare new matrix
-      // for calculations
-      for (int i = 0; i < n_enlev; ++i)
+  size_t k = 0;
+  for (size_t i = 0; i < data->numof_radtr; ++i)
+    {
+      if (!is_truncated_line (data, i, n))
         {
-          const double ii = gsl_matrix_get (data->rates, i, i)
-                            + gsl_vector_get (data->tot_rates, i);
-          gsl_matrix_set (data->rates, i, i, ii);
-
-          for (int j = 0; j < n_enlev; ++j)
-            {
-              if (i == j)
-                continue;
-
-              const double ij = gsl_matrix_get (data->rates, i, j)
-                                - gsl_matrix_get (data->coll_rates, j, i);
-              gsl_matrix_set (data->rates, i, j, ij);
-            }
+          gsl_vector_set (data->excit_temp, i,
+                          gsl_vector_get (sub->excit_temp, k));
+          gsl_vector_set (data->tau, i, gsl_vector_get (sub->tau, k));
+          ++k;
+          continue;
         }
 
-      // Prepare for calculations
-      gsl_vector *b = gsl_vector_alloc (n_enlev);
-      gsl_vector_set_all (b, 1);
-      gsl_matrix_set_row (data->rates, data->rates->size1 - 1, b);
-      gsl_vector_set_all (b, 0);
-      gsl_vector_set (b, b->size - 1, 1);
-      gsl_vector *x = gsl_vector_alloc (n_enlev);
+      const unsigned int u = data->up[i] - 1;
+      const unsigned int l = data->low[i] - 1;
+      gsl_vector_set (data->excit_temp, i, data->input.temp_kin);
+      gsl_vector_set (data->tau, i, rxi_calc_optical_depth (
+          data->input.col_dens, data->input.line_width,
+          gsl_vector_get (data->term, u) - gsl_vector_get (data->term, l),
+          gsl_vector_get (data->einst, i),
+          gsl_vector_get (data->weight, u), gsl_vector_get (data->weight, l),
+          gsl_vector_get (data->pop, u), gsl_vector_get (data->pop, l)));
+    }
 
-      gsl_permutation *p = gsl_permutation_alloc (n_enlev);
-      int s;
-      gsl_linalg_LU_decomp (data->rates, p, &s);
-      gsl_linalg_LU_solve (data->rates, p, b, x);
-      //gsl_linalg_HH_solve (data->rates, b, x);
+  data->numof_iter = sub->numof_iter;
+  data->linear_residual = sub->linear_residual;
+  data->relax = sub->relax;
+  data->numof_fallbacks = sub->numof_fallbacks;
+  data->fast_path = sub->fast_path;
+}
 
-      double total_pop = 0;
-      for (int i = 0; i < n_enlev; ++i)
-        total_pop += gsl_vector_get (x, i);
+// Solves for the lowest levels only and widens the energy cut until the
+// highest solved level holds a negligible population. Model and workspace
+// of the truncated problem are kept in `work` for the next solve.
+static RXI_STAT
+find_rates_truncated (struct rxi_calc_data *data,
+                      struct rxi_calc_workspace *work, const int n_enlev,
+                      const int n_radtr)
+{
+  unsigned int iter = 0;
+  unsigned int fallbacks = 0;
+  for (double factor = data->input.solver.truncate;; factor *= 2)
+    {
+      const size_t n_keep = truncated_levels (data, factor);
+      size_t n_lines = 0;
+      for (int i = 0; i < n_radtr; ++i)
+        n_lines += !is_truncated_line (data, i, n_keep);
 
-      gsl_vector_memcpy (prev_pop, data->pop);
-      for (int i = 0; i < n_enlev; ++i)
+      if (n_keep == (size_t) n_enlev || n_lines == 0)
         {
-          const double new_pop_i = gsl_vector_get (x, i) / total_pop;
-          gsl_vector_set (data->pop, i, fabs (new_pop_i));
+          DEBUG ("No levels truncated");
+          find_rates_all (data, work, n_enlev, n_radtr);
+          data->numof_iter += iter;
+          data->numof_fallbacks += fallbacks;
+          return RXI_OK;
         }
 
-      if (iter == 0)
-        gsl_vector_memcpy (prev_pop, data->pop);
-
-      for (int i = 0; i < n_radtr; ++i)
+      if (work->trunc_data && work->trunc_data->numof_enlev != n_keep)
         {
-          const unsigned int u = data->up[i] - 1;
-          const unsigned int l = data->low[i] - 1;
-
-          const double new_excit_temp_i = RXI_FK
-              * (gsl_vector_get (data->term, u)
-                 - gsl_vector_get (data->term, l))
-              / log (gsl_vector_get (data->pop, l)
-                     * gsl_vector_get (data->weight, u)
-                     / gsl_vector_get (data->pop, u)
-                     / gsl_vector_get (data->weight, l));
-
-          if (iter == 0)
-            {
-              gsl_matrix_set (data->excit_temp, u, l, new_excit_temp_i);
-              stop_condition = 1;
-            }
-          else
+          rxi_calc_data_free (work->trunc_data);
+          rxi_calc_workspace_free (work->trunc_work);
+          work->trunc_data = NULL;
+          work->trunc_work = NULL;
+        }
+      if (!work->trunc_data)
+        {
+          RXI_STAT status = rxi_calc_data_malloc (&work->trunc_data, n_keep,
+                                                  n_lines);
+          if (status != RXI_OK)
+            return status;
+          status = rxi_calc_workspace_malloc (&work->trunc_work, n_keep);
+          if (status != RXI_OK)
             {
-              gsl_matrix_set (data->excit_temp, u, l,
-                  0.5 * (new_excit_temp_i
-                    + gsl_matrix_get(data->excit_temp, u, l)));
+              rxi_calc_data_free (work->trunc_data);
+              work->trunc_data = NULL;
+              return status;
             }
-          const double new_tau = rxi_calc_optical_depth (data->input.col_dens,
-              data->input.line_width,
-              gsl_vector_get (data->term, u) - gsl_vector_get (data->term, l),
-              gsl_matrix_get (data->einst, u, l),
-              gsl_vector_get (data->weight, u), gsl_vector_get (data->weight, l),
-              gsl_vector_get (data->pop, u), gsl_vector_get (data->pop, l));
-
-          if (new_tau > 0.01)
-            stop_condition += fabs ((gsl_matrix_get (data->excit_temp, u, l)
-                                     - new_excit_temp_i) / new_excit_temp_i);
-
-          gsl_matrix_set (data->tau, u, l, new_tau);
+          work->trunc_data->numof_enlev = n_keep;
+          work->trunc_data->numof_radtr = n_lines;
         }
 
-      for (int i = 0; i < n_enlev; ++i)
+      struct rxi_calc_data *sub = work->trunc_data;
+      truncate_data (data, sub);
+      find_rates_all (sub, work->trunc_work, n_keep, n_lines);
+      iter += sub->numof_iter;
+      fallbacks += sub->numof_fallbacks;
+
+      const double top_pop = gsl_vector_get (sub->pop, n_keep - 1);
+      DEBUG ("Solved %zu of %d levels; population of the highest one %.3e",
+             n_keep, n_enlev, top_pop);
+      if (top_pop <= RXI_TRUNC_POP)
         {
-          const double new_pop_i =
-                      0.3 * gsl_vector_get (data->pop, i) +
-                      0.7 * gsl_vector_get (prev_pop, i);
-          gsl_vector_set (data->pop, i, new_pop_i);
+          untruncate_results (data, sub);
+          data->numof_iter = iter;
+          data->numof_fallbacks = fallbacks;
+          rxi_calc_results (data, n_radtr);
+          return RXI_OK;
         }
+    }
+}
 
-      gsl_vector_free (b);
-      gsl_vector_free (x);
-      gsl_permutation_free (p);
-      ++iter;
-      DEBUG ("%d: Thick lines: %d | Stopping cond: %.3e", iter, thick_lines,
-             stop_condition);
-    } while ((thick_lines != 0 && stop_condition / thick_lines >= 1e-7) &&
-              iter < 300);
-
-  gsl_vector_free (prev_pop);
+RXI_STAT
+rxi_calc_find_rates (struct rxi_calc_data *data,
+                     struct rxi_calc_workspace *work, const int n_enlev,
+                     const int n_radtr)
+{
+  // Starting conditions are used up
+  data->ready &= ~RXI_STAGE_PREPARE;
+  if (data->input.solver.truncate > 0)
+    return find_rates_truncated (data, work, n_enlev, n_radtr);
 
-  rxi_calc_results (data, n_radtr);
+  find_rates_all (data, work, n_enlev, n_radtr);
 
   return RXI_OK;
 }
@@ -505,6 +2319,7 @@ rxi_calc_find_rates (struct rxi_calc_data *data, const int n_enlev,
 RXI_STAT
 rxi_calc_results (struct rxi_calc_data *data, size_t numof_radtr)
 {
+  escape_probs (data, numof_radtr);
   for (unsigned int i = 0; i < numof_radtr; i++)
     {
       const int u = data->up[i] - 1;
@@ -518,7 +2333,7 @@ rxi_calc_results (struct rxi_calc_data *data, size_t numof_radtr)
       const double hnu =
                                     RXI_FK * energy
                       / //----------------------------------------
-                          gsl_matrix_get (data->excit_temp, u, l);
+                          gsl_vector_get (data->excit_temp, i);
 
       double planck = 0;
       if (hnu < 160)
@@ -528,50 +2343,49 @@ rxi_calc_results (struct rxi_calc_data *data, size_t numof_radtr)
               / //---------------------------------------------------------
                     (- 1 + exp (                  RXI_FK * energy
                                 / //------------------------------------------
-                                    gsl_matrix_get (data->excit_temp, u, l)));
+                                    gsl_vector_get (data->excit_temp, i)));
         }
       // Calculate line brightness in excess of background
       double ftau = 0;
-      if (fabs (gsl_matrix_get (data->tau, u, l)) <= 3e2)
-        ftau = exp (- gsl_matrix_get (data->tau, u, l));
+      if (fabs (gsl_vector_get (data->tau, i)) <= 3e2)
+        ftau = exp (- gsl_vector_get (data->tau, i));
 
-      const double toti = gsl_matrix_get (data->bgfield, u, l) * ftau
+      const double toti = gsl_vector_get (data->bgfield, i) * ftau
                           + planck * (1 - ftau);
 
       double tback = 0;
-      if (gsl_matrix_get (data->bgfield, u, l) != 0)
+      if (gsl_vector_get (data->bgfield, i) != 0)
         {
           tback =
                                     RXI_FK * energy
               / // -----------------------------------------------------
                    log (        2 * RXI_HP * RXI_SOL * xt
                        / //------------------------------------
-                           gsl_matrix_get (data->bgfield, u, l)      + 1);
+                           gsl_vector_get (data->bgfield, i)      + 1);
         }
 
       // Calculate antenna temperature
       double new_antenna_temp = toti;
-      if (fabs (tback / (hnu * gsl_matrix_get (data->excit_temp, u, l))) > 2e-2)
-        new_antenna_temp = toti - gsl_matrix_get (data->bgfield, u, l);
+      if (fabs (tback / (hnu * gsl_vector_get (data->excit_temp, i))) > 2e-2)
+        new_antenna_temp = toti - gsl_vector_get (data->bgfield, i);
 
       new_antenna_temp /= 2 * RXI_KB * gsl_pow_2 (energy);
-      gsl_matrix_set (data->antenna_temp, u, l, new_antenna_temp);
+      gsl_vector_set (data->antenna_temp, i, new_antenna_temp);
 
       // Calculate radiation temperature
-      const double beta = rxi_calc_escape_prob (
-                          gsl_matrix_get (data->tau, u, l), data->input.geom);
+      const double beta = gsl_vector_get (data->beta, i);
       const double Bnu = data->input.temp_bg * beta + (1 - beta) * planck;
       if (Bnu != 0)
         {
           const double wh = 2 * RXI_HP * RXI_SOL * xt / Bnu + 1;
           if (wh <= 0)
             {
-              gsl_matrix_set (data->radiation_temp, u, l,
+              gsl_vector_set (data->radiation_temp, i,
                               Bnu / (2 * RXI_KB * gsl_pow_2 (energy)));
             }
           else
             {
-              gsl_matrix_set (data->radiation_temp, u, l,
+              gsl_vector_set (data->radiation_temp, i,
                               RXI_FK * energy / log (wh));
             }
         }
@@ -593,10 +2407,7 @@ rxi_calc_chi_squared(struct rxi_calc_data *data,
       else if (radtr->freq[i] > data->input.efreq)
         break;
 
-      const int u = data->up[i] - 1;
-      const int l = data->low[i] - 1;
-
-      const double rad_temp = gsl_matrix_get (data->antenna_temp, u, l);
+      const double rad_temp = gsl_vector_get (data->antenna_temp, i);
       double user_rad_temp = radtr->intensity[i];
       double error = radtr->sigma[i];
 
@@ -612,96 +2423,300 @@ rxi_calc_chi_squared(struct rxi_calc_data *data,
 
 float
 rxi_calc_kin_temp_derivative(struct rxi_calc_data *data,
+                             struct rxi_calc_workspace *work,
                              struct rxi_input_data *inp_data,
                              struct rxi_db_molecule_info *info,
                              struct rxi_db_molecule_radtr *radtr)
 {
   double epsilon = 0.01;
-  double start_temp = inp_data->temp_kin;
 
-  rxi_calc_data_init(data, inp_data, info);
-  rxi_calc_find_rates(data, info->numof_enlev, info->numof_radtr);
+  rxi_calc_data_update (data, inp_data, info);
+  rxi_calc_find_rates(data, work, info->numof_enlev, info->numof_radtr);
   rxi_calc_chi_squared(data, radtr);
   float chi1 = data->chisq;
 
-  inp_data->temp_kin = start_temp + epsilon;
-
-  rxi_calc_data_init(data, inp_data, info);
-  rxi_calc_find_rates(data, info->numof_enlev, info->numof_radtr);
+  struct rxi_input_data shifted = *inp_data;
+  shifted.temp_kin = inp_data->temp_kin + epsilon;
+  rxi_calc_data_update (data, &shifted, info);
+  rxi_calc_find_rates(data, work, info->numof_enlev, info->numof_radtr);
   rxi_calc_chi_squared(data, radtr);
   float chi2 = data->chisq;
 
-  inp_data->temp_kin = start_temp;
-
   return (chi2 - chi1) / epsilon;
 }
 
 float
 rxi_calc_column_density_derivative (struct rxi_calc_data *data,
+                                    struct rxi_calc_workspace *work,
                                     struct rxi_input_data *inp_data,
                                     struct rxi_db_molecule_info *info,
                                     struct rxi_db_molecule_radtr *radtr)
 {
   double epsilon = 0.01;
-  double start_coldens = inp_data->col_dens;
 
-  rxi_calc_data_init(data, inp_data, info);
-  rxi_calc_find_rates(data, info->numof_enlev, info->numof_radtr);
+  rxi_calc_data_update (data, inp_data, info);
+  rxi_calc_find_rates(data, work, info->numof_enlev, info->numof_radtr);
   rxi_calc_chi_squared(data, radtr);
   float chi1 = data->chisq;
 
-  inp_data->col_dens = start_coldens + start_coldens * epsilon;
-
-  rxi_calc_data_init(data, inp_data, info);
-  rxi_calc_find_rates(data, info->numof_enlev, info->numof_radtr);
+  struct rxi_input_data shifted = *inp_data;
+  shifted.col_dens = inp_data->col_dens + inp_data->col_dens * epsilon;
+  rxi_calc_data_update (data, &shifted, info);
+  rxi_calc_find_rates(data, work, info->numof_enlev, info->numof_radtr);
   rxi_calc_chi_squared(data, radtr);
   float chi2 = data->chisq;
 
-  inp_data->col_dens = start_coldens;
-
   return (chi2 - chi1) / epsilon;
 }
 
 float
 rxi_calc_derivative (struct rxi_calc_data *data,
+                     struct rxi_calc_workspace *work,
                      struct rxi_input_data *inp_data,
                      struct rxi_db_molecule_info *info,
                      struct rxi_db_molecule_radtr *radtr)
 {
-  double start_coldens = inp_data->col_dens;
-  double start_temp = inp_data->temp_kin;
   double epsilon = 0.01;
 
-  rxi_calc_data_init(data, inp_data, info);
-  rxi_calc_find_rates(data, info->numof_enlev, info->numof_radtr);
+  rxi_calc_data_update (data, inp_data, info);
+  rxi_calc_find_rates(data, work, info->numof_enlev, info->numof_radtr);
   rxi_calc_chi_squared(data, radtr);
   float chi1 = data->chisq;
 
-  inp_data->col_dens = start_coldens + start_coldens * epsilon;
-
-  rxi_calc_data_init(data, inp_data, info);
-  rxi_calc_find_rates(data, info->numof_enlev, info->numof_radtr);
+  struct rxi_input_data shifted = *inp_data;
+  shifted.col_dens = inp_data->col_dens + inp_data->col_dens * epsilon;
+  rxi_calc_data_update (data, &shifted, info);
+  rxi_calc_find_rates(data, work, info->numof_enlev, info->numof_radtr);
   rxi_calc_chi_squared(data, radtr);
   float chi_cd_2 = data->chisq;
 
-  inp_data->col_dens = start_coldens;
-  inp_data->temp_kin = start_temp + epsilon;
-
-  rxi_calc_data_init(data, inp_data, info);
-  rxi_calc_find_rates(data, info->numof_enlev, info->numof_radtr);
+  shifted.col_dens = inp_data->col_dens;
+  shifted.temp_kin = inp_data->temp_kin + epsilon;
+  rxi_calc_data_update (data, &shifted, info);
+  rxi_calc_find_rates(data, work, info->numof_enlev, info->numof_radtr);
   rxi_calc_chi_squared(data, radtr);
   float chi_t_2 = data->chisq;
 
-  inp_data->temp_kin = start_temp;
-
   return ((chi_cd_2 - chi1) / epsilon) + ((chi_t_2 - chi1) / epsilon);
 }
 
 void
-store_result (FILE *file, const double chisq, const double tkin,
-              const double coldens)
+store_result (FILE *file, const double chisq,
+              const struct rxi_input_data *inp_data)
+{
+  fprintf (file, "%f %f %.3e", chisq, inp_data->temp_kin, inp_data->col_dens);
+  // Densities which are axes of the net follow
+  for (int8_t p = 0; p < inp_data->n_coll_partners; ++p)
+    if (inp_data->coll_part_dens_dots[p] > 0)
+      fprintf (file, " %.3e", inp_data->coll_part_dens[p]);
+  if (inp_data->line_width_dots > 0)
+    fprintf (file, " %f", inp_data->line_width);
+  fprintf (file, "\n");
+}
+
+// Column density and line width of a model of the net
+struct net_point
+{
+  double col_dens;
+  double line_width;
+};
+
+// Models of the net over column density and line width for one kinetic
+// temperature and densities. Optical depths depend on column density and
+// line width only through their ratio, so models with the same ratio have
+// the same populations and are solved once: points are sorted by the ratio
+// and split into groups of the same one.
+struct net_row
+{
+  struct net_point *point;
+  size_t numof_points;
+  size_t *group;            // Starts of groups, and then `numof_points`
+  size_t numof_groups;
+};
+
+static int
+compare_net_points (const void *a, const void *b)
+{
+  const struct net_point *p = a;
+  const struct net_point *q = b;
+  const double rp = p->col_dens / p->line_width;
+  const double rq = q->col_dens / q->line_width;
+  if (rp != rq)
+    return (rp > rq) - (rp < rq);
+
+  return (p->col_dens > q->col_dens) - (p->col_dens < q->col_dens);
+}
+
+// Sorts points of `row` by the ratio of column density to line width and
+// finds groups of the same ratio
+static void
+group_net_row (struct net_row *row)
+{
+  qsort (row->point, row->numof_points, sizeof (*row->point),
+         compare_net_points);
+
+  row->numof_groups = 0;
+  double ratio = 0;
+  for (size_t k = 0; k < row->numof_points; ++k)
+    {
+      const double r = row->point[k].col_dens / row->point[k].line_width;
+      if (k == 0 || r - ratio > RXI_NET_RATIO_TOL * ratio)
+        {
+          row->group[row->numof_groups++] = k;
+          ratio = r;
+        }
+    }
+  row->group[row->numof_groups] = row->numof_points;
+}
+
+// Stores the result of the model of group `g` of `row` for every model of
+// the group; only column densities and line widths of them differ
+static void
+store_group (FILE *file, const double chisq,
+             const struct rxi_input_data *inp_data, const struct net_row *row,
+             const size_t g)
+{
+  struct rxi_input_data point = *inp_data;
+  for (size_t k = row->group[g]; k < row->group[g + 1]; ++k)
+    {
+      point.col_dens = row->point[k].col_dens;
+      point.line_width = row->point[k].line_width;
+      store_result (file, chisq, &point);
+    }
+}
+
+// Number of points of the net over densities of collisional partners
+static size_t
+dens_net_size (const struct rxi_input_data *inp_data)
+{
+  size_t size = 1;
+  for (int8_t p = 0; p < inp_data->n_coll_partners; ++p)
+    size *= inp_data->coll_part_dens_dots[p] + 1;
+
+  return size;
+}
+
+// Sets densities of the point `k` of the net over densities; densities of
+// the first partner change fastest. Densities span orders of magnitude, so
+// they are spaced evenly in logarithm between `dens_start` and final ones
+static void
+set_dens_point (struct rxi_input_data *inp_data, const double *dens_start,
+                size_t k)
+{
+  for (int8_t p = 0; p < inp_data->n_coll_partners; ++p)
+    {
+      const int dots = inp_data->coll_part_dens_dots[p];
+      if (dots == 0)
+        continue;
+
+      const size_t i = k % (dots + 1);
+      k /= dots + 1;
+      inp_data->coll_part_dens[p] = dens_start[p]
+          * pow (inp_data->coll_part_dens_final[p] / dens_start[p],
+                 (double) i / dots);
+    }
+}
+
+// Solves `count` models set up for a net and stores their results in order.
+// Model `m` stands for the group `groups[m]` of `row`.
+static void
+solve_net_chunk (struct rxi_calc_data **models, const size_t count,
+                 struct rxi_calc_batch *batch,
+                 struct rxi_db_molecule_radtr *radtr, FILE *file,
+                 const struct net_row *row, const size_t *groups)
+{
+  rxi_calc_find_rates_batch (models, count, batch);
+  for (size_t m = 0; m < count; ++m)
+    {
+      rxi_calc_chi_squared (models[m], radtr);
+      store_group (file, models[m]->chisq, &models[m]->input, row,
+                   groups[m]);
+      DEBUG ("chisq: %f | T: %f | CD: %.3e | iterations: %u",
+             models[m]->chisq, models[m]->input.temp_kin,
+             models[m]->input.col_dens, models[m]->numof_iter);
+    }
+}
+
+// Builds a net of parameters through `rxi_calc_find_rates_batch()`. A few
+// batches worth of models are set up at once, so lanes of converged models
+// are refilled right away.
+static RXI_STAT
+find_good_fit_batched (struct rxi_input_data *inp_data,
+                       const struct rxi_db_molecule_info *info,
+                       struct rxi_db_molecule_radtr *radtr, FILE *file,
+                       const double tkin_step, const double *dens_start,
+                       const size_t dens_points, const struct net_row *row)
 {
-  fprintf (file, "%f %f %.3e\n", chisq, tkin, coldens);
+  const size_t n_chunk = 4 * inp_data->solver.batch_size;
+
+  struct rxi_calc_batch *batch;
+  RXI_STAT status = rxi_calc_batch_malloc (&batch, info->numof_enlev,
+                                           info->numof_radtr,
+                                           inp_data->solver.batch_size);
+  if (status != RXI_OK)
+    return status;
+
+  size_t n_models = 0;
+  size_t *groups = calloc (n_chunk, sizeof (*groups));
+  CHECK (groups && "Allocation error");
+  struct rxi_calc_data **models = calloc (n_chunk, sizeof (*models));
+  CHECK (models && "Allocation error");
+  if (!groups || !models)
+    {
+      status = RXI_ERR_ALLOC;
+      goto cleanup;
+    }
+
+  for (; n_models < n_chunk; ++n_models)
+    {
+      status = rxi_calc_data_malloc (&models[n_models], info->numof_enlev,
+                                     info->numof_radtr);
+      if (status != RXI_OK)
+        goto cleanup;
+    }
+
+  // Tables of partners and unit density rates take n^2 memory per partner,
+  // so models of the chunk share the ones of the first model
+  status = rxi_calc_data_update (models[0], inp_data, info);
+  if (status != RXI_OK)
+    goto cleanup;
+  for (size_t m = 1; m < n_chunk; ++m)
+    rxi_calc_data_share_molecule (models[m], models[0]);
+
+  size_t count = 0;
+  for (double tkin = inp_data->temp_kin; tkin <= inp_data->temp_kin_final; tkin += tkin_step)
+    {
+      inp_data->temp_kin = tkin;
+      for (size_t d = 0; d < dens_points; ++d)
+        {
+          set_dens_point (inp_data, dens_start, d);
+          for (size_t g = 0; g < row->numof_groups; ++g)
+            {
+              const struct net_point *point = &row->point[row->group[g]];
+              inp_data->col_dens = point->col_dens;
+              inp_data->line_width = point->line_width;
+              groups[count] = g;
+              status = rxi_calc_data_update (models[count++], inp_data, info);
+              if (status != RXI_OK)
+                goto cleanup;
+              if (count == n_chunk)
+                {
+                  solve_net_chunk (models, count, batch, radtr, file, row,
+                                   groups);
+                  count = 0;
+                }
+            }
+        }
+    }
+  solve_net_chunk (models, count, batch, radtr, file, row, groups);
+
+cleanup:
+  for (size_t m = 0; m < n_models; ++m)
+    rxi_calc_data_free (models[m]);
+  free (models);
+  free (groups);
+  rxi_calc_batch_free (batch);
+  return status;
 }
 
 RXI_STAT
@@ -716,22 +2731,30 @@ rxi_calc_find_good_fit (struct rxi_calc_data *data,
   if (!file)
     return RXI_ERR_FILE;
 
+  struct rxi_calc_workspace *work;
+  result = rxi_calc_workspace_malloc (&work, info->numof_enlev);
+  if (result != RXI_OK)
+    {
+      fclose (file);
+      return result;
+    }
+
   if ((inp_data->temp_kin_dots == 0) && (inp_data->col_dens_dots == 0))
     {
       DEBUG ("Find good fit by two parameters");
-      float temp_der = rxi_calc_kin_temp_derivative (data, inp_data, info, radtr);
-      float cd_der = rxi_calc_column_density_derivative (data, inp_data, info, radtr);
+      float temp_der = rxi_calc_kin_temp_derivative (data, work, inp_data, info, radtr);
+      float cd_der = rxi_calc_column_density_derivative (data, work, inp_data, info, radtr);
       float grad = temp_der + cd_der;
       int i = 0;
       while (fabs (grad) > 10 && ++i < 1000)
         {
           inp_data->temp_kin -= temp_der / 25;
           inp_data->col_dens -= inp_data->col_dens / cd_der;
-          temp_der = rxi_calc_kin_temp_derivative (data, inp_data, info, radtr);
-          cd_der = rxi_calc_column_density_derivative (data, inp_data, info, radtr);
+          temp_der = rxi_calc_kin_temp_derivative (data, work, inp_data, info, radtr);
+          cd_der = rxi_calc_column_density_derivative (data, work, inp_data, info, radtr);
           grad = temp_der + cd_der;
 
-          store_result (file, data->chisq, inp_data->temp_kin, inp_data->col_dens);
+          store_result (file, data->chisq, inp_data);
           DEBUG ("%d | full derivative: %f | T: %f | CD: %.3e", i, grad, inp_data->temp_kin, inp_data->col_dens);
         }
     }
@@ -747,8 +2770,8 @@ rxi_calc_find_good_fit (struct rxi_calc_data *data,
           while (fabs (grad) > 3 && ++i < 1000)
             {
               inp_data->temp_kin -= grad / 25;
-              grad = rxi_calc_kin_temp_derivative (data, inp_data, info, radtr);
-              store_result (file, data->chisq, inp_data->temp_kin, inp_data->col_dens);
+              grad = rxi_calc_kin_temp_derivative (data, work, inp_data, info, radtr);
+              store_result (file, data->chisq, inp_data);
               DEBUG ("%d | tkin derivative: %f | T: %f | CD: %.3e", i, grad, inp_data->temp_kin, inp_data->col_dens);
             }
         }
@@ -765,9 +2788,9 @@ rxi_calc_find_good_fit (struct rxi_calc_data *data,
           while (fabs (grad) > 1 && ++i < 1000)
             {
               inp_data->col_dens -= inp_data->col_dens / grad;
-              grad = rxi_calc_column_density_derivative (data, inp_data, info, radtr);
+              grad = rxi_calc_column_density_derivative (data, work, inp_data, info, radtr);
 
-              store_result (file, data->chisq, inp_data->temp_kin, inp_data->col_dens);
+              store_result (file, data->chisq, inp_data);
               DEBUG ("%d | coldens derivative: %f | T: %f | CD: %.3e", i, grad, inp_data->temp_kin, inp_data->col_dens);
             }
         }
@@ -778,25 +2801,97 @@ rxi_calc_find_good_fit (struct rxi_calc_data *data,
       double tkin_step = fabs ((inp_data->temp_kin - inp_data->temp_kin_final) / inp_data->temp_kin_dots);
       double coldens_step = fabs ((inp_data->col_dens - inp_data->col_dens_final) / inp_data->col_dens_dots);
       double coldens_start = inp_data->col_dens;
-      for (double tkin = inp_data->temp_kin; tkin <= inp_data->temp_kin_final; tkin += tkin_step)
+      int coldens_dots = 0;
+      for (double cd = coldens_start; cd <= inp_data->col_dens_final; cd += coldens_step)
+        ++coldens_dots;
+
+      // Line width is an axis of the net if it has dots
+      double width_start = inp_data->line_width;
+      double width_step = 0;
+      int width_dots = 1;
+      if (inp_data->line_width_dots > 0)
         {
-          inp_data->temp_kin = tkin;
-          for (double cd = coldens_start; cd <= inp_data->col_dens_final; cd += coldens_step)
+          width_step = fabs ((inp_data->line_width - inp_data->line_width_final) / inp_data->line_width_dots);
+          width_dots = 0;
+          for (double lw = width_start; lw <= inp_data->line_width_final; lw += width_step)
+            ++width_dots;
+        }
+
+      struct net_row row;
+      row.numof_points = (size_t) coldens_dots * width_dots;
+      row.point = malloc (row.numof_points * sizeof (*row.point));
+      row.group = malloc ((row.numof_points + 1) * sizeof (*row.group));
+      CHECK ((row.point && row.group) && "Allocation error");
+      if (!row.point || !row.group)
+        {
+          free (row.point);
+          free (row.group);
+          rxi_calc_workspace_free (work);
+          fclose (file);
+          return RXI_ERR_ALLOC;
+        }
+      for (int j = 0; j < coldens_dots; ++j)
+        for (int w = 0; w < width_dots; ++w)
+          row.point[j * width_dots + w] = (struct net_point) {
+              .col_dens = coldens_start + j * coldens_step,
+              .line_width = width_start + w * width_step };
+      group_net_row (&row);
+      DEBUG ("%zu of %zu models of every row of the net are solved",
+             row.numof_groups, row.numof_points);
+
+      // Densities of partners with dots are more axes of the net; for every
+      // temperature the rates of their points are sums of the same unit
+      // density rates
+      double dens_start[RXI_COLL_PARTNERS_MAX];
+      memcpy (dens_start, inp_data->coll_part_dens, sizeof (dens_start));
+      const size_t dens_points = dens_net_size (inp_data);
+
+      if (inp_data->solver.batch_size > 0)
+        result = find_good_fit_batched (inp_data, info, radtr, file,
+                                        tkin_step, dens_start, dens_points,
+                                        &row);
+      else
+        {
+          // With warm start every other row goes backwards (serpentine
+          // order), so each model is solved right after its nearest
+          // neighbour on the grid
+          bool backwards = false;
+          for (double tkin = inp_data->temp_kin; tkin <= inp_data->temp_kin_final; tkin += tkin_step)
             {
-              inp_data->col_dens = cd;
-              rxi_calc_data_init(data, inp_data, info);
-              rxi_calc_find_rates(data, info->numof_enlev, info->numof_radtr);
-              rxi_calc_chi_squared(data, radtr);
-              store_result (file, data->chisq, inp_data->temp_kin, inp_data->col_dens);
-              DEBUG ("chisq: %f | T: %f | CD: %.3e", data->chisq, inp_data->temp_kin, inp_data->col_dens);
+              inp_data->temp_kin = tkin;
+              for (size_t d = 0; d < dens_points; ++d)
+                {
+                  set_dens_point (inp_data, dens_start, d);
+                  for (size_t g = 0; g < row.numof_groups; ++g)
+                    {
+                      const size_t k = backwards ? row.numof_groups - 1 - g : g;
+                      inp_data->col_dens = row.point[row.group[k]].col_dens;
+                      inp_data->line_width = row.point[row.group[k]].line_width;
+                      rxi_calc_data_update (data, inp_data, info);
+                      rxi_calc_find_rates(data, work, info->numof_enlev, info->numof_radtr);
+                      rxi_calc_chi_squared(data, radtr);
+                      store_group (file, data->chisq, inp_data, &row, k);
+                      DEBUG ("chisq: %f | T: %f | CD: %.3e | iterations: %u", data->chisq, inp_data->temp_kin, inp_data->col_dens, data->numof_iter);
+                    }
+                  if (inp_data->solver.warm_start)
+                    backwards = !backwards;
+                }
             }
         }
+      free (row.point);
+      free (row.group);
     }
   else
     {
       DEBUG ("No option to calculate");
     }
 
+  size_t cache_hits, cache_misses;
+  rxi_coll_cache_stats (&cache_hits, &cache_misses);
+  DEBUG ("Collisional rates cache: %zu hits, %zu misses", cache_hits,
+         cache_misses);
+
+  rxi_calc_workspace_free (work);
   fclose (file);
   return result;
 }
@@ -831,7 +2926,7 @@ rxi_calc_escape_prob (const double tau, const GEOMETRY geom)
   else if (geom == SLAB)
     {
       if (fabs (3 * tau) < 0.1)
-        beta = 1 - 1.5 * (tau + tau * 2);
+        beta = 1 - 1.5 * tau + 1.5 * pow (tau, 2) - 1.125 * pow (tau, 3);
       else if (fabs (3 * tau) > 50)
         beta = 1 / (3 * tau);
       else
@@ -850,6 +2945,61 @@ rxi_calc_escape_prob (const double tau, const GEOMETRY geom)
   return beta;
 }
 
+double
+rxi_calc_escape_prob_deriv (const double tau, const GEOMETRY geom)
+{
+  double dbeta = 0;
+  const double tau_rad = tau / 2;
+
+  if (geom == SPHERE)
+    {
+      double dbeta_rad = 0;
+      if (fabs (tau_rad) < 0.1)
+        dbeta_rad = -0.75 + 0.8 * tau_rad - pow (tau_rad, 2) / 2 + \
+                    4 * pow (tau_rad, 3) / 17.5;
+      else if (fabs (tau_rad) > 50)
+        dbeta_rad = -0.75 / pow (tau_rad, 2);
+      else
+        {
+          const double e = exp (-2 * tau_rad);
+          const double f = 1 - 1 / (2 * pow (tau_rad, 2)) + \
+                           (1 / tau_rad + 1 / (2 * pow (tau_rad, 2))) * e;
+          const double df = 1 / pow (tau_rad, 3) - \
+                            (2 / tau_rad + 2 / pow (tau_rad, 2) + \
+                             1 / pow (tau_rad, 3)) * e;
+          dbeta_rad = 0.75 / tau_rad * (df - f / tau_rad);
+        }
+      dbeta = dbeta_rad / 2;
+    }
+  else if (geom == SLAB)
+    {
+      if (fabs (3 * tau) < 0.1)
+        dbeta = -1.5 + 3 * tau - 3.375 * pow (tau, 2);
+      else if (fabs (3 * tau) > 50)
+        dbeta = -1 / (3 * pow (tau, 2));
+      else
+        dbeta = (3 * tau * exp (-3 * tau) - (1 - exp (-3 * tau)))
+                / (3 * pow (tau, 2));
+    }
+  else if (geom == LVG)
+    {
+      if (fabs (tau_rad) < 0.01)
+        dbeta = 0;
+      else if (fabs (tau_rad) < 7)
+        dbeta = (2.34 * tau_rad * exp (-2.34 * tau_rad)
+                 - (1 - exp (-2.34 * tau_rad)))
+                / (2.34 * pow (tau_rad, 2)) / 2;
+      else
+        {
+          const double lg = log (tau_rad / sqrt (M_PI));
+          dbeta = -(1 + 1 / (2 * lg))
+                  / (2 * pow (tau_rad, 2) * sqrt (lg)) / 2;
+        }
+    }
+
+  return dbeta;
+}
+
 double
 rxi_calc_optical_depth (const double coldens, const double line_width,
     const double energy, const double einst, const double ustat,
@@ -860,3 +3010,125 @@ rxi_calc_optical_depth (const double coldens, const double line_width,
       / //--------------------------------------------------------
           (gsl_pow_3 (energy) * 1.0645 * 8.0 * M_PI * line_width);
 }
+
+// Array kernels work on chunks of `RXI_ARRAY_CHUNK` elements. Branches of
+// the scalar functions become selects between values computed for every
+// element. All of them are built from one reciprocal, so the compiler can't
+// sink a division into a branch and vectorizes the loop. Calls to libm are
+// made in a separate loop and only for elements which need them.
+
+// Writes `f (arg[i])` to `res[i]` for elements with `need[i]` set.
+RXI_KERNEL void
+call_where (double (*f) (double), const bool *restrict need,
+            const double *restrict arg, double *restrict res)
+{
+  for (size_t i = 0; i < RXI_ARRAY_CHUNK; ++i)
+    if (need[i])
+      res[i] = f (arg[i]);
+}
+
+RXI_KERNEL void
+escape_prob_sphere (const double *restrict tau, double *restrict beta)
+{
+  bool need[RXI_ARRAY_CHUNK];
+  double arg[RXI_ARRAY_CHUNK];
+  double e[RXI_ARRAY_CHUNK];
+  for (size_t i = 0; i < RXI_ARRAY_CHUNK; ++i)
+    {
+      need[i] = (fabs (tau[i] / 2) >= 0.1) && (fabs (tau[i] / 2) <= 50);
+      arg[i] = -tau[i];
+      e[i] = 0;
+    }
+  call_where (exp, need, arg, e);
+
+  for (size_t i = 0; i < RXI_ARRAY_CHUNK; ++i)
+    {
+      const double tau_rad = tau[i] / 2;
+      const double tau_rad2 = tau_rad * tau_rad;
+      const double inv = 1 / tau_rad;
+      const double series = 1 - 0.75 * tau_rad + 0.4 * tau_rad2
+                            - tau_rad2 * tau_rad / 6
+                            + tau_rad2 * tau_rad2 / 17.5;
+      const double thick = 0.75 * inv;
+      const double mid = thick * (1 - 0.5 * inv * inv
+                                  + (inv + 0.5 * inv * inv) * e[i]);
+      beta[i] = (fabs (tau_rad) < 0.1) ? series
+                : (fabs (tau_rad) > 50) ? thick : mid;
+    }
+}
+
+RXI_KERNEL void
+escape_prob_slab (const double *restrict tau, double *restrict beta)
+{
+  bool need[RXI_ARRAY_CHUNK];
+  double arg[RXI_ARRAY_CHUNK];
+  double e[RXI_ARRAY_CHUNK];
+  for (size_t i = 0; i < RXI_ARRAY_CHUNK; ++i)
+    {
+      need[i] = (fabs (3 * tau[i]) >= 0.1) && (fabs (3 * tau[i]) <= 50);
+      arg[i] = -3 * tau[i];
+      e[i] = 0;
+    }
+  call_where (exp, need, arg, e);
+
+  for (size_t i = 0; i < RXI_ARRAY_CHUNK; ++i)
+    {
+      const double t = tau[i];
+      const double series = 1 - 1.5 * t + 1.5 * t * t - 1.125 * t * t * t;
+      const double thick = 1 / (3 * t);
+      const double mid = (1 - e[i]) * thick;
+      beta[i] = (fabs (3 * t) < 0.1) ? series
+                : (fabs (3 * t) > 50) ? thick : mid;
+    }
+}
+
+// Both branches for thicker lines need libm, so there is nothing to turn
+// into selects; the loop only saves the dispatch on geometry.
+RXI_KERNEL void
+escape_prob_lvg (const double *restrict tau, double *restrict beta)
+{
+  for (size_t i = 0; i < RXI_ARRAY_CHUNK; ++i)
+    {
+      const double tau_rad = tau[i] / 2;
+      if (fabs (tau_rad) < 0.01)
+        beta[i] = 1;
+      else if (fabs (tau_rad) < 7)
+        beta[i] = 2 * (1 - exp (-2.34 * tau_rad)) / (4.68 * tau_rad);
+      else
+        beta[i] = 2 / (tau_rad * 4 * sqrt (log (tau_rad / sqrt (M_PI))));
+    }
+}
+
+RXI_KERNEL void
+escape_prob_chunk (const GEOMETRY geom, const double *restrict tau,
+                   double *restrict beta)
+{
+  if (geom == SPHERE)
+    escape_prob_sphere (tau, beta);
+  else if (geom == SLAB)
+    escape_prob_slab (tau, beta);
+  else if (geom == LVG)
+    escape_prob_lvg (tau, beta);
+  else
+    memset (beta, 0, RXI_ARRAY_CHUNK * sizeof (*beta));
+}
+
+RXI_SIMD_CLONES void
+rxi_calc_escape_prob_array (const GEOMETRY geom, const size_t n,
+                            const double *restrict tau, double *restrict beta)
+{
+  size_t j = 0;
+  for (; j + RXI_ARRAY_CHUNK <= n; j += RXI_ARRAY_CHUNK)
+    escape_prob_chunk (geom, tau + j, beta + j);
+
+  if (j == n)
+    return;
+
+  // The tail is padded to a full chunk
+  double tau_tail[RXI_ARRAY_CHUNK];
+  double beta_tail[RXI_ARRAY_CHUNK];
+  for (size_t i = 0; i < RXI_ARRAY_CHUNK; ++i)
+    tau_tail[i] = (j + i < n) ? tau[j + i] : 1;
+  escape_prob_chunk (geom, tau_tail, beta_tail);
+  memcpy (beta + j, beta_tail, (n - j) * sizeof (*beta));
+}
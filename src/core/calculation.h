@@ -7,18 +7,106 @@
 
 /// @brief Initializes `struct rxi_calc_data` to start calculations.
 ///
-/// Uses `rxi_calc_data_fill()` to fill `struct rxi_calc_data` with data from
-/// local database and input info. If you already have read data from database
-/// just use `rxi_calc_data_fill()`.
+/// Runs all setup stages of `rxi_calc_data_update()` for @p inp_data, except
+/// reading the database if @p calc_data holds tables of the same molecule
+/// already. If you already have read data from database just use
+/// `rxi_calc_data_fill()`.
 /// @param *calc_data -- structure you need to fill (allocate memory for this
 /// before);
 /// @param *inp_data -- starting conditions are written here;
 /// @param *mol_info --
-/// @return `RXI_OK`
+/// @return `RXI_OK`; an error of the database reading otherwise.
 RXI_STAT rxi_calc_data_init (struct rxi_calc_data *calc_data,
                              const struct rxi_input_data *inp_data,
                              const struct rxi_db_molecule_info *mol_info);
 
+/// @brief Brings `struct rxi_calc_data` up to date with @p inp_data,
+/// redoing only the setup stages whose inputs changed.
+///
+/// Copies @p inp_data to `calc_data->input` and runs the stages, each of
+/// which takes its inputs from `calc_data->input`:
+/// - `rxi_calc_data_load_molecule()` -- `name`, `coll_part`;
+/// - `rxi_calc_data_set_temp_kin()` -- `temp_kin`, `solver.coll_interp`;
+/// - `rxi_calc_data_set_densities()` -- `coll_part_dens`;
+/// - `rxi_calc_data_set_temp_bg()` -- `temp_bg`;
+/// - `rxi_calc_data_prepare()` -- `col_dens`, `line_width`, `geom`.
+///
+/// A stage runs if its fields differ from the ones `calc_data->ready` says
+/// it was done for, or if a stage whose results it uses runs. Collisional
+/// rates are taken from the cache if they are there. A solve uses up the
+/// starting conditions, so they are set again after it. Fitters and nets
+/// call this function for every model.
+/// @param *calc_data -- structure allocated by `rxi_calc_data_malloc()`;
+/// @param *inp_data -- parameters of the model;
+/// @param *mol_info -- information about the molecule.
+/// @return `RXI_OK`; an error of the database reading otherwise.
+RXI_STAT rxi_calc_data_update (struct rxi_calc_data *calc_data,
+                               const struct rxi_input_data *inp_data,
+                               const struct rxi_db_molecule_info *mol_info);
+
+/// @brief Reads levels, radiative transitions and tables of collisional
+/// partners of the molecule from the database.
+/// @param *calc_data -- calculation data; tables of partners are kept in
+/// `calc_data->coll`;
+/// @param *mol_info -- information about the molecule.
+/// @return `RXI_OK` on success; an error of the database reading or
+/// `RXI_ERR_ALLOC` otherwise.
+RXI_STAT rxi_calc_data_load_molecule (struct rxi_calc_data *calc_data,
+    const struct rxi_db_molecule_info *mol_info);
+
+/// @brief `rxi_calc_data_load_molecule()` for tables which are already in
+/// memory.
+///
+/// Tables of partners are copied, so the caller keeps @p mol_cp.
+/// @param *calc_data -- calculation data; `calc_data->input` names the
+/// molecule and its partners;
+/// @param *mol_info -- information about the molecule;
+/// @param *mol_enlev -- energy levels;
+/// @param *mol_radtr -- radiative transitions;
+/// @param **mol_cp -- tables of partners in the order of
+/// `calc_data->input.coll_part`.
+/// @return `RXI_OK` on success; `RXI_ERR_ALLOC` otherwise.
+RXI_STAT rxi_calc_data_load_tables (struct rxi_calc_data *calc_data,
+    const struct rxi_db_molecule_info *mol_info,
+    const struct rxi_db_molecule_enlev *mol_enlev,
+    const struct rxi_db_molecule_radtr *mol_radtr,
+    struct rxi_db_molecule_coll_part *const *mol_cp);
+
+/// @brief Makes @p calc_data a model of the molecule loaded into @p owner.
+///
+/// Levels and lines are copied. Tables of partners, their interpolated
+/// coefficients and unit density rates are shared, so a net of many models
+/// keeps one copy of them. The shared coefficients are interpolated again
+/// whenever a model needs another temperature, and each model keeps the
+/// rates summed from them. Loading another molecule into either model
+/// gives it tables of its own.
+/// @param *calc_data -- calculation data of the same size as @p owner;
+/// @param *owner -- calculation data with a loaded molecule.
+void rxi_calc_data_share_molecule (struct rxi_calc_data *calc_data,
+                                   const struct rxi_calc_data *owner);
+
+/// @brief Interpolates collision coefficients of the loaded partners to the
+/// kinetic temperature, fills Boltzmann factors of levels and rates of every
+/// partner at unit density.
+/// @param *calc_data -- calculation data with a loaded molecule;
+/// @param *mol_info -- information about the molecule.
+void rxi_calc_data_set_temp_kin (struct rxi_calc_data *calc_data,
+    const struct rxi_db_molecule_info *mol_info);
+
+/// @brief Fills `coll_rates`, `tot_rates` and `rates_archive` as the sum of
+/// unit density rates of partners weighted by their densities.
+///
+/// Takes one AXPY per partner, so models which differ only in densities
+/// don't interpolate coefficients again.
+void rxi_calc_data_set_densities (struct rxi_calc_data *calc_data);
+
+/// @brief Fills `bgfield` for the background temperature.
+void rxi_calc_data_set_temp_bg (struct rxi_calc_data *calc_data);
+
+/// @brief Sets optically thin starting conditions for the current rates,
+/// column density and line width.
+void rxi_calc_data_prepare (struct rxi_calc_data *calc_data);
+
 /// @brief TODO
 RXI_STAT rxi_calc_data_fill (const struct rxi_input_data *inp_data,
                              const struct rxi_db_molecule_info *mol_info,
@@ -27,8 +115,21 @@ RXI_STAT rxi_calc_data_fill (const struct rxi_input_data *inp_data,
                              struct rxi_db_molecule_coll_part **mol_cp,
                              struct rxi_calc_data *calc_data);
 
-RXI_STAT rxi_calc_find_rates (struct rxi_calc_data *data, const int n_enlev,
-                              const int n_radtr);
+/// @brief Solves statistical equilibrium for prepared `struct rxi_calc_data`.
+///
+/// All temporaries are taken from @p work, so repeated calls for models of
+/// the same molecule don't allocate memory. The exceptions are the first
+/// `LS_LOWRANK` solve and truncated solves (`truncate` option), which allocate
+/// a model for every number of solved levels they try.
+/// @param *data -- structure filled by `rxi_calc_data_init()`;
+/// @param *work -- workspace allocated for `n_enlev` levels by
+/// `rxi_calc_workspace_malloc()`;
+/// @param n_enlev -- number of energy levels;
+/// @param n_radtr -- number of radiative transitions.
+/// @return `RXI_OK`
+RXI_STAT rxi_calc_find_rates (struct rxi_calc_data *data,
+                              struct rxi_calc_workspace *work,
+                              const int n_enlev, const int n_radtr);
 
 RXI_STAT rxi_calc_results (struct rxi_calc_data *data, size_t numof_radtr);
 
@@ -42,6 +143,25 @@ double rxi_calc_crate (const double istat, const double jstat,
 
 double rxi_calc_escape_prob (const double tau, const GEOMETRY geom);
 
+/// @brief Derivative of `rxi_calc_escape_prob()` with respect to `tau`.
+///
+/// Differentiates the same piecewise approximations, so it is consistent with
+/// the escape probability used in the rate matrix.
+double rxi_calc_escape_prob_deriv (const double tau, const GEOMETRY geom);
+
 double rxi_calc_optical_depth (const double coldens, const double line_width,
     const double energy, const double einst, const double ustat,
     const double lstat, const double upop, const double lpop);
+
+/// @brief `rxi_calc_escape_prob()` for an array of optical depths.
+///
+/// Checks the geometry once per chunk of elements instead of once per line
+/// and runs vectorized kernels; AVX-512 or AVX2 versions are used if the CPU
+/// supports them. Results agree with the scalar function to rounding.
+/// @param geom -- radiation field geometry;
+/// @param n -- number of elements;
+/// @param *tau -- optical depths;
+/// @param *beta -- escape probabilities are written here.
+void rxi_calc_escape_prob_array (const GEOMETRY geom, const size_t n,
+                                 const double *restrict tau,
+                                 double *restrict beta);
@@ -0,0 +1,176 @@
+/**
+ * @file core/coll_cache.c
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+
+#include "core/coll_cache.h"
+
+#include "rxi_common.h"
+#include "utils/debug.h"
+
+// Parameters which collisional rates depend on
+struct coll_key
+{
+  char name[RXI_MOLECULE_MAX];
+  size_t numof_enlev;
+  double temp_kin;
+  COLL_INTERP coll_interp;
+  int8_t n_coll_partners;
+  COLL_PART coll_part[RXI_COLL_PARTNERS_MAX];
+  double coll_part_dens[RXI_COLL_PARTNERS_MAX];
+};
+
+struct coll_entry
+{
+  bool used;
+  unsigned long last_use;   // Value of `use_count` on the last use
+  struct coll_key key;
+  gsl_matrix *coll_rates;
+  gsl_vector *tot_rates;
+};
+
+static struct coll_entry entries[RXI_COLL_CACHE_SIZE];
+static unsigned long use_count = 0;
+static size_t numof_hits = 0;
+static size_t numof_misses = 0;
+
+static void
+make_key (const struct rxi_input_data *inp_data, const size_t n_enlev,
+          struct coll_key *key)
+{
+  strcpy (key->name, inp_data->name);
+  key->numof_enlev = n_enlev;
+  key->temp_kin = inp_data->temp_kin;
+  key->coll_interp = inp_data->solver.coll_interp;
+  key->n_coll_partners = inp_data->n_coll_partners;
+  for (int8_t i = 0; i < inp_data->n_coll_partners; ++i)
+    {
+      key->coll_part[i] = inp_data->coll_part[i];
+      key->coll_part_dens[i] = inp_data->coll_part_dens[i];
+    }
+}
+
+static bool
+same_key (const struct coll_key *a, const struct coll_key *b)
+{
+  if (strcmp (a->name, b->name) != 0 || a->numof_enlev != b->numof_enlev
+      || a->temp_kin != b->temp_kin || a->coll_interp != b->coll_interp
+      || a->n_coll_partners != b->n_coll_partners)
+    return false;
+
+  for (int8_t i = 0; i < a->n_coll_partners; ++i)
+    {
+      if (a->coll_part[i] != b->coll_part[i]
+          || a->coll_part_dens[i] != b->coll_part_dens[i])
+        return false;
+    }
+
+  return true;
+}
+
+bool
+rxi_coll_cache_get (const struct rxi_input_data *inp_data,
+                    struct rxi_calc_data *data)
+{
+  struct coll_key key;
+  make_key (inp_data, data->coll_rates->size1, &key);
+
+  for (size_t i = 0; i < RXI_COLL_CACHE_SIZE; ++i)
+    {
+      struct coll_entry *entry = &entries[i];
+      if (!entry->used || !same_key (&entry->key, &key))
+        continue;
+
+      gsl_matrix_memcpy (data->coll_rates, entry->coll_rates);
+      gsl_vector_memcpy (data->tot_rates, entry->tot_rates);
+      entry->last_use = ++use_count;
+      ++numof_hits;
+      return true;
+    }
+
+  ++numof_misses;
+  return false;
+}
+
+RXI_STAT
+rxi_coll_cache_put (const struct rxi_input_data *inp_data,
+                    const struct rxi_calc_data *data)
+{
+  const size_t n = data->coll_rates->size1;
+
+  struct coll_entry *entry = &entries[0];
+  for (size_t i = 0; i < RXI_COLL_CACHE_SIZE; ++i)
+    {
+      if (!entries[i].used)
+        {
+          entry = &entries[i];
+          break;
+        }
+      if (entries[i].last_use < entry->last_use)
+        entry = &entries[i];
+    }
+
+  // Memory of an evicted entry is reused for rates of the same size
+  if (entry->coll_rates && entry->coll_rates->size1 != n)
+    {
+      gsl_matrix_free (entry->coll_rates);
+      gsl_vector_free (entry->tot_rates);
+      entry->coll_rates = NULL;
+      entry->tot_rates = NULL;
+    }
+  entry->used = false;
+
+  if (!entry->coll_rates)
+    {
+      entry->coll_rates = gsl_matrix_alloc (n, n);
+      entry->tot_rates = gsl_vector_alloc (n);
+      CHECK ((entry->coll_rates && entry->tot_rates) && "Allocation error");
+      if (!entry->coll_rates || !entry->tot_rates)
+        {
+          gsl_matrix_free (entry->coll_rates);
+          gsl_vector_free (entry->tot_rates);
+          entry->coll_rates = NULL;
+          entry->tot_rates = NULL;
+          return RXI_ERR_ALLOC;
+        }
+    }
+
+  make_key (inp_data, n, &entry->key);
+  gsl_matrix_memcpy (entry->coll_rates, data->coll_rates);
+  gsl_vector_memcpy (entry->tot_rates, data->tot_rates);
+  entry->last_use = ++use_count;
+  entry->used = true;
+
+  return RXI_OK;
+}
+
+void
+rxi_coll_cache_stats (size_t *hits, size_t *misses)
+{
+  *hits = numof_hits;
+  *misses = numof_misses;
+}
+
+void
+rxi_coll_cache_clear (void)
+{
+  for (size_t i = 0; i < RXI_COLL_CACHE_SIZE; ++i)
+    {
+      if (entries[i].coll_rates)
+        {
+          gsl_matrix_free (entries[i].coll_rates);
+          gsl_vector_free (entries[i].tot_rates);
+        }
+      entries[i].coll_rates = NULL;
+      entries[i].tot_rates = NULL;
+      entries[i].used = false;
+    }
+  use_count = 0;
+  numof_hits = 0;
+  numof_misses = 0;
+}
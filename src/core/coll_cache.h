@@ -0,0 +1,45 @@
+/**
+ * @file core/coll_cache.h
+ * @brief Cache of collisional rates between models of one run.
+ */
+
+#ifndef RXI_COLL_CACHE_H
+#define RXI_COLL_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rxi_common.h"
+
+//! Largest number of cached sets of collisional rates.
+#define RXI_COLL_CACHE_SIZE 8
+
+/// @brief Copies cached collisional rates of the model of `inp_data` to
+/// `coll_rates` and `tot_rates` of `data`.
+///
+/// Rates depend on the molecule, collisional partners and their densities,
+/// kinetic temperature and interpolation method, so models of a net which
+/// differ only in column density or line width share them.
+/// @param *inp_data -- parameters of the model;
+/// @param *data -- calculation data of the model.
+/// @return `true` if rates were found in the cache.
+bool rxi_coll_cache_get (const struct rxi_input_data *inp_data,
+                         struct rxi_calc_data *data);
+
+/// @brief Stores `coll_rates` and `tot_rates` of `data` for the model of
+/// `inp_data`, in place of the least recently used entry if the cache is
+/// full.
+/// @param *inp_data -- parameters of the model;
+/// @param *data -- calculation data with filled collisional rates.
+/// @return `RXI_OK` on success; `RXI_ERR_ALLOC` on allocation error.
+RXI_STAT rxi_coll_cache_put (const struct rxi_input_data *inp_data,
+                             const struct rxi_calc_data *data);
+
+/// @brief Number of lookups by `rxi_coll_cache_get()` which found rates and
+/// which did not since the start or `rxi_coll_cache_clear()`.
+void rxi_coll_cache_stats (size_t *hits, size_t *misses);
+
+/// @brief Frees all cached rates and resets counters.
+void rxi_coll_cache_clear (void);
+
+#endif  // RXI_COLL_CACHE_H
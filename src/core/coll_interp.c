@@ -0,0 +1,208 @@
+/**
+ * @file core/coll_interp.c
+ */
+
+#include <math.h>
+
+#include "core/coll_interp.h"
+
+#include "rxi_common.h"
+#include "utils/debug.h"
+
+// Index of the first of `n` ascending `temps` not below `temp`, or `n` if
+// all of them are below it
+static size_t
+lower_bound (const double *temps, const size_t n, const double temp)
+{
+  size_t lo = 0;
+  size_t hi = n;
+  while (lo < hi)
+    {
+      const size_t mid = lo + (hi - lo) / 2;
+      if (temps[mid] < temp)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+// Writes to `w` weights of rate coefficients in the second derivative of a
+// natural cubic spline at temperature `k`. The derivatives at inner
+// temperatures solve a tridiagonal system `K M = D y` with symmetric `K`, so
+// the weights are `D^T z` for `K z = e_k`.
+static void
+spline_moment_weights (const double *temps, const size_t n, const size_t k,
+                       double *w)
+{
+  for (size_t t = 0; t < n; ++t)
+    w[t] = 0;
+  if (n < 3 || k == 0 || k == n - 1)
+    return;
+
+  // Forward sweep of the Thomas algorithm over inner temperatures 1 .. n-2
+  double diag[RXI_COLL_TEMPS_MAX];
+  double z[RXI_COLL_TEMPS_MAX];
+  for (size_t j = 1; j + 1 < n; ++j)
+    {
+      const double h_prev = temps[j] - temps[j - 1];
+      const double h_next = temps[j + 1] - temps[j];
+      diag[j] = 2 * (h_prev + h_next);
+      z[j] = (j == k) ? 1 : 0;
+      if (j > 1)
+        {
+          const double factor = h_prev / diag[j - 1];
+          diag[j] -= factor * h_prev;
+          z[j] -= factor * z[j - 1];
+        }
+    }
+  for (size_t j = n - 2; j >= 1; --j)
+    {
+      if (j + 2 < n)
+        z[j] -= (temps[j + 1] - temps[j]) * z[j + 1];
+      z[j] /= diag[j];
+    }
+
+  for (size_t j = 1; j + 1 < n; ++j)
+    {
+      const double h_prev = temps[j] - temps[j - 1];
+      const double h_next = temps[j + 1] - temps[j];
+      w[j - 1] += 6 * z[j] / h_prev;
+      w[j] -= 6 * z[j] * (1 / h_prev + 1 / h_next);
+      w[j + 1] += 6 * z[j] / h_next;
+    }
+}
+
+void
+rxi_coll_interp_init (struct rxi_coll_interp *interp,
+                      const COLL_INTERP method, const double *temps,
+                      const size_t n_temps, const double temp_kin)
+{
+  ASSERT ((n_temps > 0 && n_temps <= RXI_COLL_TEMPS_MAX)
+          && "Wrong number of collisional temperatures");
+
+  interp->method = method;
+  interp->numof_temps = n_temps;
+  interp->weight = 0;
+  interp->log_weight = 0;
+
+  const size_t i = lower_bound (temps, n_temps, temp_kin);
+  if (method == CI_LINEAR)
+    {
+      interp->lo = (i < n_temps) ? i : n_temps - 1;
+      interp->hi = (i + 1 < n_temps) ? i + 1 : interp->lo;
+    }
+  else
+    {
+      interp->lo = (i > 0) ? i - 1 : 0;
+      interp->hi = (i < n_temps) ? i : n_temps - 1;
+      if (i > 0 && i < n_temps && temps[i] == temp_kin)
+        interp->lo = i;
+    }
+
+  const double t_lo = temps[interp->lo];
+  const double t_hi = temps[interp->hi];
+  if (interp->lo != interp->hi)
+    {
+      interp->weight = (temp_kin - t_lo) / (t_hi - t_lo);
+      if (t_lo > 0)
+        interp->log_weight = log (temp_kin / t_lo) / log (t_hi / t_lo);
+      else
+        interp->log_weight = interp->weight;
+    }
+
+  if (method != CI_SPLINE)
+    return;
+
+  // s(T) = A y_lo + B y_hi + ((A^3 - A) M_lo + (B^3 - B) M_hi) h^2 / 6
+  double w_lo[RXI_COLL_TEMPS_MAX];
+  double w_hi[RXI_COLL_TEMPS_MAX];
+  spline_moment_weights (temps, n_temps, interp->lo, w_lo);
+  spline_moment_weights (temps, n_temps, interp->hi, w_hi);
+  const double b = interp->weight;
+  const double a = 1 - b;
+  const double h2 = (t_hi - t_lo) * (t_hi - t_lo) / 6;
+  for (size_t t = 0; t < n_temps; ++t)
+    interp->spline[t] = h2 * ((a * a * a - a) * w_lo[t]
+                              + (b * b * b - b) * w_hi[t]);
+  interp->spline[interp->lo] += a;
+  interp->spline[interp->hi] += b;
+}
+
+void
+rxi_coll_interp_rates (const struct rxi_coll_interp *interp,
+                       const size_t n_trans, const double *restrict rates,
+                       const size_t tda, double *restrict coefs)
+{
+  const size_t lo = interp->lo;
+  const size_t hi = interp->hi;
+  const double weight = interp->weight;
+
+  switch (interp->method)
+    {
+    case CI_LOGLOG:
+      for (size_t k = 0; k < n_trans; ++k)
+        {
+          const double r_lo = rates[k * tda + lo];
+          const double r_hi = rates[k * tda + hi];
+          // Zero coefficients have no logarithm
+          if (r_lo > 0 && r_hi > 0)
+            coefs[k] = r_lo * pow (r_hi / r_lo, interp->log_weight);
+          else
+            coefs[k] = r_lo + weight * (r_hi - r_lo);
+        }
+      break;
+
+    case CI_SPLINE:
+      for (size_t k = 0; k < n_trans; ++k)
+        {
+          const double *row = rates + k * tda;
+          double coef = 0;
+          for (size_t t = 0; t < interp->numof_temps; ++t)
+            coef += interp->spline[t] * row[t];
+          // Splines overshoot near steep drops to zero
+          coefs[k] = fmax (coef, 0);
+        }
+      break;
+
+    case CI_LINEAR:
+    default:
+      for (size_t k = 0; k < n_trans; ++k)
+        {
+          const double r_lo = rates[k * tda + lo];
+          const double r_hi = rates[k * tda + hi];
+          coefs[k] = r_lo + weight * (r_hi - r_lo);
+        }
+      break;
+    }
+}
+
+void
+rxi_coll_interp_bracket (const struct rxi_coll_interp *interp,
+                         const size_t n_trans, const double *restrict rates,
+                         const size_t tda, double *restrict base,
+                         double *restrict slope)
+{
+  const size_t lo = interp->lo;
+  const size_t hi = interp->hi;
+  for (size_t k = 0; k < n_trans; ++k)
+    {
+      base[k] = rates[k * tda + lo];
+      slope[k] = rates[k * tda + hi] - base[k];
+    }
+}
+
+void
+rxi_coll_interp_blend (const struct rxi_coll_interp *interp,
+                       const size_t n_trans, const double *restrict base,
+                       const double *restrict slope, double *restrict coefs)
+{
+  ASSERT ((interp->method == CI_LINEAR)
+          && "Only linear interpolation is affine in temperature");
+
+  // Contiguous arrays, so the loop is vectorized
+  const double weight = interp->weight;
+  for (size_t k = 0; k < n_trans; ++k)
+    coefs[k] = base[k] + weight * slope[k];
+}
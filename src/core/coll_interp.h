@@ -0,0 +1,89 @@
+/**
+ * @file core/coll_interp.h
+ * @brief Interpolation of collisional rate coefficients in temperature.
+ */
+
+#ifndef RXI_COLL_INTERP_H
+#define RXI_COLL_INTERP_H
+
+#include <stddef.h>
+
+#include "rxi_common.h"
+
+/// @brief Interpolation to one kinetic temperature on the temperature grid of
+/// a collisional partner.
+///
+/// The bracket of temperatures and the weights depend only on the grid, so
+/// they are found once by `rxi_coll_interp_init()` and shared by all
+/// transitions of the partner.
+struct rxi_coll_interp
+{
+  COLL_INTERP method;
+  size_t numof_temps;
+  size_t lo;              //!< Lower temperature of the bracket.
+  size_t hi;              //!< Upper temperature of the bracket.
+  double weight;          //!< Linear weight of `hi`.
+  double log_weight;      //!< Weight of `hi` in logarithm of temperature.
+  //! Weights of all temperatures of a natural cubic spline.
+  double spline[RXI_COLL_TEMPS_MAX];
+};
+
+/// @brief Finds the bracket of `temp_kin` by binary search and computes the
+/// weights of `method`.
+///
+/// `CI_LINEAR` takes the first temperature not below `temp_kin` and the next
+/// one, as earlier versions did, so it extrapolates below the lowest one and
+/// keeps the rate coefficient of the highest one above it. Other methods use
+/// the temperatures around `temp_kin` and keep the coefficients of the ends
+/// of the grid outside of it.
+/// @param *interp -- interpolation to initialize;
+/// @param method -- interpolation method;
+/// @param *temps -- ascending temperatures of the partner;
+/// @param n_temps -- number of temperatures, at most `RXI_COLL_TEMPS_MAX`;
+/// @param temp_kin -- kinetic temperature.
+void rxi_coll_interp_init (struct rxi_coll_interp *interp,
+                           const COLL_INTERP method, const double *temps,
+                           const size_t n_temps, const double temp_kin);
+
+/// @brief Rate coefficients of all transitions of a partner at the
+/// temperature of `interp`.
+/// @param *interp -- interpolation from `rxi_coll_interp_init()`;
+/// @param n_trans -- number of transitions;
+/// @param *rates -- rate coefficients of transitions, one row of
+/// `numof_temps` values per transition;
+/// @param tda -- distance between rows of `rates`;
+/// @param *coefs -- interpolated coefficients are written here.
+void rxi_coll_interp_rates (const struct rxi_coll_interp *interp,
+                            const size_t n_trans,
+                            const double *restrict rates, const size_t tda,
+                            double *restrict coefs);
+
+/// @brief Splits linear interpolation of `interp` into coefficients at the
+/// lower temperature of its bracket and their differences to the upper one.
+///
+/// `CI_LINEAR` coefficients are affine in kinetic temperature within one
+/// bracket, so they are found for any temperature of it by
+/// `rxi_coll_interp_blend()` without reading the table again.
+/// @param *interp -- interpolation from `rxi_coll_interp_init()`;
+/// @param n_trans -- number of transitions;
+/// @param *rates -- rate coefficients as in `rxi_coll_interp_rates()`;
+/// @param tda -- distance between rows of `rates`;
+/// @param *base -- coefficients at the lower temperature are written here;
+/// @param *slope -- their differences to the upper one are written here.
+void rxi_coll_interp_bracket (const struct rxi_coll_interp *interp,
+                              const size_t n_trans,
+                              const double *restrict rates, const size_t tda,
+                              double *restrict base, double *restrict slope);
+
+/// @brief `CI_LINEAR` coefficients at the temperature of `interp` from the
+/// bracket of `rxi_coll_interp_bracket()`.
+///
+/// Bracket of @p interp must be the one @p base and @p slope were found for.
+/// Results are the same as of `rxi_coll_interp_rates()`.
+void rxi_coll_interp_blend (const struct rxi_coll_interp *interp,
+                            const size_t n_trans,
+                            const double *restrict base,
+                            const double *restrict slope,
+                            double *restrict coefs);
+
+#endif  // RXI_COLL_INTERP_H
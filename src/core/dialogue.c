@@ -241,9 +241,9 @@ get_coldens (double *coldens, double *coldens_fin, int *numof_dots)
 }
 
 static RXI_STAT
-get_line_width (double *line_width)
+get_line_width (double *line_width, double *line_width_fin, int *numof_dots)
 {
-  DEBUG ("Get collision densities");
+  DEBUG ("Get line width");
 
   char *line = malloc (RXI_STRING_MAX * sizeof (*line));
   CHECK (line && "Allocation error");
@@ -257,9 +257,18 @@ get_line_width (double *line_width)
   bool is_written = false;
   while (!is_written && ((line = rxi_readline ("  >> ")) != NULL))
     {
-      *line_width = strtod (line, NULL);
-      if ((*line_width > 1e-3) && (*line_width < 1e3))
+      int n = sscanf (line, "%lf %lf %d", line_width, line_width_fin,
+                      numof_dots);
+      if (((n == 1) && (*line_width > 1e-3) && (*line_width < 1e3))
+          || ((n >= 2) && (*line_width > 1e-3) && (*line_width < 1e3)
+              && (*line_width_fin > 1e-3) && (*line_width_fin < 1e3)))
         {
+          // Line width is an axis of the net only if dots are given
+          if (n < 3)
+            {
+              *line_width_fin = *line_width;
+              *numof_dots = 0;
+            }
           is_written = true;
           rxi_history_save (line, "line_width.history");
         }
@@ -315,8 +324,7 @@ get_geometry (GEOMETRY *geom)
 }
 
 static void
-parse_collision_partners (char *line, COLL_PART *coll_part,
-                          double *coll_part_dens, int8_t *n_coll_part)
+parse_collision_partners (char *line, struct rxi_input_data *inp_data)
 {
   int8_t i = 0;
   for (char *tok = strtok (line, ";"); tok; tok = strtok (NULL, ";"))
@@ -324,17 +332,27 @@ parse_collision_partners (char *line, COLL_PART *coll_part,
       DEBUG ("Parsing %s", tok);
       char *pair = malloc (RXI_STRING_MAX * sizeof (*pair));
       CHECK (pair);
-      memcpy (pair, tok, RXI_STRING_MAX);
+      if (!pair)
+        break;
 
-      int n = sscanf (tok, "%s %lf", pair, &coll_part_dens[i]);
+      // Density of a partner is either fixed or an axis of the net given by
+      // its starting and final values and number of dots
+      double dens_fin = 0;
+      int dens_dots = 0;
+      int n = sscanf (tok, "%s %lf %lf %d", pair, &inp_data->coll_part_dens[i],
+                      &dens_fin, &dens_dots);
       COLL_PART cp = nametonum (pair);
-      if ((cp != NO_PARTNER) && (n < 3))
+      if ((cp != NO_PARTNER)
+          && ((n < 3) || ((n == 4) && (dens_fin > 0) && (dens_dots > 0))))
         {
-          coll_part[i] = cp;
+          inp_data->coll_part[i] = cp;
+          inp_data->coll_part_dens_final[i] = (n == 4) ? dens_fin : 0;
+          inp_data->coll_part_dens_dots[i] = (n == 4) ? dens_dots : 0;
           ++i;
         }
+      free (pair);
     }
-  *n_coll_part = i;
+  inp_data->n_coll_partners = i;
 }
 
 static bool
@@ -394,8 +412,7 @@ get_collision_partners (struct rxi_input_data *inp_data)
   bool is_written = false;
   while (!is_written && ((line = rxi_readline ("  >> ")) != NULL))
     {
-      parse_collision_partners (line, inp_data->coll_part,
-          inp_data->coll_part_dens, &inp_data->n_coll_partners);
+      parse_collision_partners (line, inp_data);
 
       for (int8_t i = 0; i < inp_data->n_coll_partners; ++i)
         {
@@ -460,7 +477,8 @@ rxi_dialog_input (struct rxi_input_data *inp_data)
 
   printf ("  ## Enter line width\n");
 
-  status = get_line_width (&inp_data->line_width);
+  status = get_line_width (&inp_data->line_width, &inp_data->line_width_final,
+                           &inp_data->line_width_dots);
   CHECK ((status == RXI_OK) && "Error getting line width");
 
   printf ("  ## Enter geometry\n");
@@ -0,0 +1,219 @@
+/**
+ * @file core/escape_table.c
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/escape_table.h"
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+
+//! Polynomials per octave of optical depth are `1 << RXI_ESCAPE_TABLE_BITS`.
+//! With 128 of them the largest relative error is about 2e-10.
+#define RXI_ESCAPE_TABLE_BITS 7
+
+// Bits of the mantissa below the segment index
+#define FRAC_BITS (52 - RXI_ESCAPE_TABLE_BITS)
+
+// Branch of `rxi_calc_escape_prob()` replaced by a table on [2^lo, 2^hi)
+struct escape_table
+{
+  int lo;
+  int hi;
+  double (*branch) (double);
+  double (*coef)[4];
+};
+
+static double
+sphere_branch (const double tau)
+{
+  const double tau_rad = tau / 2;
+  return 0.75 / tau_rad * (1 - 1 / (2 * pow (tau_rad, 2))
+         + (1 / tau_rad + 1 / (2 * pow (tau_rad, 2))) * exp (-2 * tau_rad));
+}
+
+static double
+slab_branch (const double tau)
+{
+  return (1 - exp (-3 * tau)) / (3 * tau);
+}
+
+static double
+lvg_branch (const double tau)
+{
+  const double tau_rad = tau / 2;
+  return 2 * (1 - exp (-2.34 * tau_rad)) / (4.68 * tau_rad);
+}
+
+static double
+lvg_thick_branch (const double tau)
+{
+  const double tau_rad = tau / 2;
+  return 2 / (tau_rad * 4 * sqrt (log (tau_rad / sqrt (M_PI))));
+}
+
+// Octaves cover the branches: sphere on [0.2, 100], slab on [1/30, 50/3], LVG
+// on [0.02, 14) and up to 2^24 for its optically thick branch
+#define SEGMENTS(lo, hi) (((hi) - (lo)) << RXI_ESCAPE_TABLE_BITS)
+static double sphere_coef[SEGMENTS (-3, 7)][4];
+static double slab_coef[SEGMENTS (-5, 5)][4];
+static double lvg_coef[SEGMENTS (-6, 4)][4];
+static double lvg_thick_coef[SEGMENTS (3, 24)][4];
+
+static struct escape_table sphere_table = { -3, 7, sphere_branch, sphere_coef };
+static struct escape_table slab_table = { -5, 5, slab_branch, slab_coef };
+static struct escape_table lvg_table = { -6, 4, lvg_branch, lvg_coef };
+static struct escape_table lvg_thick_table = { 3, 24, lvg_thick_branch,
+                                               lvg_thick_coef };
+
+static bool tables_ready = false;
+
+// Fits a cubic in `t` from [0, 1] to the branch on every segment. Nodes are
+// the Chebyshev points, which keep the error small at segment ends.
+static void
+build_table (struct escape_table *table)
+{
+  double t[4];
+  for (int j = 0; j < 4; ++j)
+    t[j] = 0.5 - 0.5 * cos ((2 * j + 1) * M_PI / 8);
+
+  const size_t n_seg = SEGMENTS (table->lo, table->hi);
+  for (size_t s = 0; s < n_seg; ++s)
+    {
+      const int octave = table->lo + (int) (s >> RXI_ESCAPE_TABLE_BITS);
+      const size_t in_octave = s & ((1 << RXI_ESCAPE_TABLE_BITS) - 1);
+      const double width = ldexp (1, octave - RXI_ESCAPE_TABLE_BITS);
+      const double start = ldexp (1, octave) + in_octave * width;
+
+      // Divided differences of the Newton form
+      double d[4];
+      for (int j = 0; j < 4; ++j)
+        d[j] = table->branch (start + t[j] * width);
+      for (int k = 1; k < 4; ++k)
+        {
+          for (int j = 3; j >= k; --j)
+            d[j] = (d[j] - d[j - 1]) / (t[j] - t[j - k]);
+        }
+
+      // Expand d0 + d1 (t - t0) + d2 (t - t0) (t - t1) + ... into monomials
+      double *c = table->coef[s];
+      c[0] = d[3];
+      c[1] = 0;
+      c[2] = 0;
+      c[3] = 0;
+      for (int j = 2; j >= 0; --j)
+        {
+          // c = c * (t - t[j]) + d[j]
+          c[3] = c[2];
+          c[2] = c[1] - t[j] * c[2];
+          c[1] = c[0] - t[j] * c[1];
+          c[0] = d[j] - t[j] * c[0];
+        }
+    }
+}
+
+static void
+build_tables (void)
+{
+  build_table (&sphere_table);
+  build_table (&slab_table);
+  build_table (&lvg_table);
+  build_table (&lvg_thick_table);
+  tables_ready = true;
+}
+
+// Value of the table for positive `tau` in its octaves. For positive
+// doubles, bits above the mantissa fraction grow with the value, so they
+// number the segments in order.
+static inline double
+lookup (const struct escape_table *table, const double tau)
+{
+  uint64_t bits;
+  memcpy (&bits, &tau, sizeof (bits));
+  const uint64_t first = (uint64_t) (1023 + table->lo) << RXI_ESCAPE_TABLE_BITS;
+  const double *c = table->coef[(bits >> FRAC_BITS) - first];
+  const double t = (bits & ((UINT64_C (1) << FRAC_BITS) - 1))
+                   * (1.0 / (UINT64_C (1) << FRAC_BITS));
+  return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+}
+
+static inline double
+sphere_prob (const double tau)
+{
+  const double tau_rad = tau / 2;
+  if (fabs (tau_rad) < 0.1)
+    {
+      const double tau_rad2 = tau_rad * tau_rad;
+      return 1 - 0.75 * tau_rad + 0.4 * tau_rad2 - tau_rad2 * tau_rad / 6
+             + tau_rad2 * tau_rad2 / 17.5;
+    }
+  else if (fabs (tau_rad) > 50)
+    return 0.75 / tau_rad;
+  else if (tau > 0)
+    return lookup (&sphere_table, tau);
+  else
+    return rxi_calc_escape_prob (tau, SPHERE);
+}
+
+static inline double
+slab_prob (const double tau)
+{
+  if (fabs (3 * tau) < 0.1)
+    return 1 - 1.5 * tau + 1.5 * tau * tau - 1.125 * tau * tau * tau;
+  else if (fabs (3 * tau) > 50)
+    return 1 / (3 * tau);
+  else if (tau > 0)
+    return lookup (&slab_table, tau);
+  else
+    return rxi_calc_escape_prob (tau, SLAB);
+}
+
+static inline double
+lvg_prob (const double tau)
+{
+  const double tau_rad = tau / 2;
+  if (fabs (tau_rad) < 0.01)
+    return 1;
+  else if (tau_rad > 0 && tau_rad < 7)
+    return lookup (&lvg_table, tau);
+  else if (tau_rad >= 7 && tau < 0x1p24)
+    return lookup (&lvg_thick_table, tau);
+  else
+    return rxi_calc_escape_prob (tau, LVG);
+}
+
+void
+rxi_calc_escape_prob_table (const GEOMETRY geom, const size_t n,
+                            const double *restrict tau, double *restrict beta)
+{
+  if (!tables_ready)
+    build_tables ();
+
+  // Branches switch at the same optical depths as in
+  // `rxi_calc_escape_prob()`; optically thin and thick limits are cheap and
+  // computed directly
+  if (geom == SPHERE)
+    {
+      for (size_t i = 0; i < n; ++i)
+        beta[i] = sphere_prob (tau[i]);
+    }
+  else if (geom == SLAB)
+    {
+      for (size_t i = 0; i < n; ++i)
+        beta[i] = slab_prob (tau[i]);
+    }
+  else if (geom == LVG)
+    {
+      for (size_t i = 0; i < n; ++i)
+        beta[i] = lvg_prob (tau[i]);
+    }
+  else
+    {
+      for (size_t i = 0; i < n; ++i)
+        beta[i] = 0;
+    }
+}
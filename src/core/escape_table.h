@@ -0,0 +1,33 @@
+/**
+ * @file core/escape_table.h
+ * @brief Escape probabilities by table lookup.
+ */
+
+#ifndef RXI_ESCAPE_TABLE_H
+#define RXI_ESCAPE_TABLE_H
+
+#include "rxi_common.h"
+
+//! Bound of relative difference between `rxi_calc_escape_prob_table()` and
+//! `rxi_calc_escape_prob()`.
+#define RXI_ESCAPE_TABLE_ERROR 1e-9
+
+/// @brief Escape probabilities for an array of optical depths from tables.
+///
+/// Branches of `rxi_calc_escape_prob()` which need `exp()` or `log()` are
+/// replaced by cubic polynomials, one for each 1/128 of an octave of optical
+/// depth, so every value costs a few multiply-adds. The polynomial is found by
+/// the exponent and the leading bits of the mantissa of `tau`, without
+/// computing a logarithm. The tables are built on the first call. Optically
+/// thin and thick limits are computed directly, and negative optical depths
+/// go to `rxi_calc_escape_prob()`. Relative error is below
+/// `RXI_ESCAPE_TABLE_ERROR`.
+/// @param geom -- radiation field geometry;
+/// @param n -- number of elements;
+/// @param *tau -- optical depths;
+/// @param *beta -- escape probabilities are written here.
+void rxi_calc_escape_prob_table (const GEOMETRY geom, const size_t n,
+                                 const double *restrict tau,
+                                 double *restrict beta);
+
+#endif  // RXI_ESCAPE_TABLE_H
@@ -0,0 +1,499 @@
+/**
+ * @file core/linalg.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_permutation.h>
+#include <gsl/gsl_linalg.h>
+#include <gsl/gsl_blas.h>
+
+#include "core/linalg.h"
+
+#include "rxi_common.h"
+#include "utils/debug.h"
+
+//! Columns in one panel of the blocked LU. A panel of rows of U for
+//! matrices up to a few hundred levels stays in L2 cache.
+#define RXI_LU_BLOCK 32
+
+#ifdef RXI_USE_LAPACK
+extern void dgetrf_ (const int *m, const int *n, double *a, const int *lda,
+                     int *ipiv, int *info);
+
+// LAPACK stores matrices by columns, so the storage of row-major `a` is the
+// transpose for it. Transposing before and after `dgetrf` gives factors in
+// the layout GSL uses; both transpositions are cheap compared to the
+// decomposition.
+static void
+lapack_LU_decomp (gsl_matrix *a, gsl_permutation *p)
+{
+  const int n = a->size1;
+  const int lda = a->tda;
+  int ipiv[n];
+  int info;
+
+  gsl_matrix_transpose (a);
+  dgetrf_ (&n, &n, a->data, &lda, ipiv, &info);
+  gsl_matrix_transpose (a);
+  CHECK ((info >= 0) && "Wrong arguments to dgetrf");
+
+  // Row interchanges of LAPACK to GSL's permutation
+  gsl_permutation_init (p);
+  for (int i = 0; i < n; ++i)
+    gsl_permutation_swap (p, i, ipiv[i] - 1);
+}
+#endif
+
+// Two doubles; SSE2 and NEON registers on every supported 64-bit target
+typedef double rxi_vec2 __attribute__ ((vector_size (2 * sizeof (double))));
+
+static inline rxi_vec2
+load_vec2 (const double *x)
+{
+  rxi_vec2 v;
+  memcpy (&v, x, sizeof (v));
+  return v;
+}
+
+static inline void
+store_vec2 (double *x, const rxi_vec2 v)
+{
+  memcpy (x, &v, sizeof (v));
+}
+
+// y -= a x
+static inline void
+sub_scaled_row (const size_t n, const double a, const double *restrict x,
+                double *restrict y)
+{
+  size_t j = 0;
+  for (; j + 2 <= n; j += 2)
+    store_vec2 (y + j, load_vec2 (y + j) - a * load_vec2 (x + j));
+  for (; j < n; ++j)
+    y[j] -= a * x[j];
+}
+
+// y -= a[0] x[0] + ... + a[3] x[3], loading and storing `y` once
+static inline void
+sub_scaled_rows4 (const size_t n, const double *a, const double *x[4],
+                  double *restrict y)
+{
+  size_t j = 0;
+  for (; j + 2 <= n; j += 2)
+    store_vec2 (y + j, load_vec2 (y + j) - a[0] * load_vec2 (x[0] + j)
+                       - a[1] * load_vec2 (x[1] + j)
+                       - a[2] * load_vec2 (x[2] + j)
+                       - a[3] * load_vec2 (x[3] + j));
+  for (; j < n; ++j)
+    y[j] -= a[0] * x[0][j] + a[1] * x[1][j] + a[2] * x[2][j] + a[3] * x[3][j];
+}
+
+// Four floats, the same register width as `rxi_vec2`
+typedef float rxi_vec4f __attribute__ ((vector_size (4 * sizeof (float))));
+
+static inline rxi_vec4f
+load_vec4f (const float *x)
+{
+  rxi_vec4f v;
+  memcpy (&v, x, sizeof (v));
+  return v;
+}
+
+static inline void
+store_vec4f (float *x, const rxi_vec4f v)
+{
+  memcpy (x, &v, sizeof (v));
+}
+
+// y -= a x in single precision
+static inline void
+sub_scaled_row_float (const size_t n, const float a, const float *restrict x,
+                      float *restrict y)
+{
+  size_t j = 0;
+  for (; j + 4 <= n; j += 4)
+    store_vec4f (y + j, load_vec4f (y + j) - a * load_vec4f (x + j));
+  for (; j < n; ++j)
+    y[j] -= a * x[j];
+}
+
+// y -= a[0] x[0] + ... + a[3] x[3] in single precision
+static inline void
+sub_scaled_rows4_float (const size_t n, const float *a, const float *x[4],
+                        float *restrict y)
+{
+  size_t j = 0;
+  for (; j + 4 <= n; j += 4)
+    store_vec4f (y + j, load_vec4f (y + j) - a[0] * load_vec4f (x[0] + j)
+                        - a[1] * load_vec4f (x[1] + j)
+                        - a[2] * load_vec4f (x[2] + j)
+                        - a[3] * load_vec4f (x[3] + j));
+  for (; j < n; ++j)
+    y[j] -= a[0] * x[0][j] + a[1] * x[1][j] + a[2] * x[2][j] + a[3] * x[3][j];
+}
+
+// Right-looking LU with partial pivoting on panels of `RXI_LU_BLOCK`
+// columns. All updates go along contiguous rows, and the trailing matrix is
+// updated once per panel instead of once per column, reusing the panel's
+// rows of U from cache. Pivots are the largest elements of columns, as in
+// GSL.
+static void
+blocked_LU_decomp (gsl_matrix *a, gsl_permutation *p)
+{
+  const size_t n = a->size1;
+  const size_t tda = a->tda;
+  double *m = a->data;
+
+  gsl_permutation_init (p);
+  for (size_t k0 = 0; k0 < n; k0 += RXI_LU_BLOCK)
+    {
+      const size_t k1 = (k0 + RXI_LU_BLOCK < n) ? k0 + RXI_LU_BLOCK : n;
+
+      // Factorize the panel, swapping whole rows
+      for (size_t k = k0; k < k1; ++k)
+        {
+          size_t piv = k;
+          double max = fabs (m[k * tda + k]);
+          for (size_t i = k + 1; i < n; ++i)
+            {
+              if (fabs (m[i * tda + k]) > max)
+                {
+                  max = fabs (m[i * tda + k]);
+                  piv = i;
+                }
+            }
+
+          if (piv != k)
+            {
+              gsl_matrix_swap_rows (a, k, piv);
+              gsl_permutation_swap (p, k, piv);
+            }
+
+          const double pivot = m[k * tda + k];
+          if (pivot == 0)
+            continue;
+
+          for (size_t i = k + 1; i < n; ++i)
+            {
+              double *row = m + i * tda;
+              row[k] /= pivot;
+              sub_scaled_row (k1 - k - 1, row[k], m + k * tda + k + 1,
+                              row + k + 1);
+            }
+        }
+
+      if (k1 == n)
+        break;
+
+      // Rows of U right to the panel
+      for (size_t k = k0; k < k1; ++k)
+        {
+          for (size_t i = k + 1; i < k1; ++i)
+            sub_scaled_row (n - k1, m[i * tda + k], m + k * tda + k1,
+                            m + i * tda + k1);
+        }
+
+      // Trailing matrix, row by row, with four rows of U at once
+      for (size_t i = k1; i < n; ++i)
+        {
+          double *row = m + i * tda;
+          size_t k = k0;
+          for (; k + 4 <= k1; k += 4)
+            {
+              const double *u[4] = { m + k * tda + k1, m + (k + 1) * tda + k1,
+                                     m + (k + 2) * tda + k1,
+                                     m + (k + 3) * tda + k1 };
+              sub_scaled_rows4 (n - k1, row + k, u, row + k1);
+            }
+          for (; k < k1; ++k)
+            sub_scaled_row (n - k1, row[k], m + k * tda + k1, row + k1);
+        }
+    }
+}
+
+bool
+rxi_linalg_has_backend (const LU_BACKEND backend)
+{
+  switch (backend)
+    {
+    case LB_GSL:
+    case LB_BLOCKED:
+      return true;
+
+    case LB_LAPACK:
+#ifdef RXI_USE_LAPACK
+      return true;
+#else
+      return false;
+#endif
+    }
+
+  return false;
+}
+
+void
+rxi_linalg_LU_decomp (const LU_BACKEND backend, gsl_matrix *a,
+                      gsl_permutation *p)
+{
+  ASSERT ((a->size1 == a->size2) && (a->size1 == p->size)
+          && "Sizes mismatch");
+
+  int s;
+  switch (backend)
+    {
+    case LB_BLOCKED:
+      blocked_LU_decomp (a, p);
+      break;
+
+    case LB_LAPACK:
+#ifdef RXI_USE_LAPACK
+      lapack_LU_decomp (a, p);
+      break;
+#endif
+
+    case LB_GSL:
+    default:
+      gsl_linalg_LU_decomp (a, p, &s);
+      break;
+    }
+}
+
+void
+rxi_linalg_equilibrate (gsl_matrix *a, gsl_vector *r, gsl_vector *c)
+{
+  const size_t n = a->size1;
+  ASSERT ((n == a->size2) && (n == r->size) && (n == c->size)
+          && (r->stride == 1) && (c->stride == 1) && "Sizes mismatch");
+
+  double *restrict row_scale = gsl_vector_ptr (r, 0);
+  double *restrict col_scale = gsl_vector_ptr (c, 0);
+
+  // Powers of two nearest to the inverse largest elements: scaling is exact
+  // and doesn't add rounding errors
+  for (size_t j = 0; j < n; ++j)
+    col_scale[j] = 0;
+  for (size_t i = 0; i < n; ++i)
+    {
+      const double *row = gsl_matrix_const_ptr (a, i, 0);
+      double max = 0;
+      for (size_t j = 0; j < n; ++j)
+        max = fmax (max, fabs (row[j]));
+
+      int e = 0;
+      if (max > 0)
+        frexp (max, &e);
+      row_scale[i] = ldexp (1, -e);
+
+      for (size_t j = 0; j < n; ++j)
+        col_scale[j] = fmax (col_scale[j], fabs (row[j]) * row_scale[i]);
+    }
+  for (size_t j = 0; j < n; ++j)
+    {
+      int e = 0;
+      if (col_scale[j] > 0)
+        frexp (col_scale[j], &e);
+      col_scale[j] = ldexp (1, -e);
+    }
+
+  for (size_t i = 0; i < n; ++i)
+    {
+      double *row = gsl_matrix_ptr (a, i, 0);
+      for (size_t j = 0; j < n; ++j)
+        row[j] *= row_scale[i] * col_scale[j];
+    }
+}
+
+void
+rxi_linalg_LU_decomp_float (const size_t n, float *a, gsl_permutation *p)
+{
+  ASSERT ((n == p->size) && "Sizes mismatch");
+
+  // Same scheme as `blocked_LU_decomp()`; a vector register holds twice as
+  // many elements
+  gsl_permutation_init (p);
+  for (size_t k0 = 0; k0 < n; k0 += RXI_LU_BLOCK)
+    {
+      const size_t k1 = (k0 + RXI_LU_BLOCK < n) ? k0 + RXI_LU_BLOCK : n;
+
+      for (size_t k = k0; k < k1; ++k)
+        {
+          size_t piv = k;
+          float max = fabsf (a[k * n + k]);
+          for (size_t i = k + 1; i < n; ++i)
+            {
+              if (fabsf (a[i * n + k]) > max)
+                {
+                  max = fabsf (a[i * n + k]);
+                  piv = i;
+                }
+            }
+
+          if (piv != k)
+            {
+              for (size_t j = 0; j < n; ++j)
+                {
+                  const float tmp = a[k * n + j];
+                  a[k * n + j] = a[piv * n + j];
+                  a[piv * n + j] = tmp;
+                }
+              gsl_permutation_swap (p, k, piv);
+            }
+
+          const float pivot = a[k * n + k];
+          if (pivot == 0)
+            continue;
+
+          for (size_t i = k + 1; i < n; ++i)
+            {
+              float *row = a + i * n;
+              row[k] /= pivot;
+              sub_scaled_row_float (k1 - k - 1, row[k], a + k * n + k + 1,
+                                    row + k + 1);
+            }
+        }
+
+      if (k1 == n)
+        break;
+
+      for (size_t k = k0; k < k1; ++k)
+        {
+          for (size_t i = k + 1; i < k1; ++i)
+            sub_scaled_row_float (n - k1, a[i * n + k], a + k * n + k1,
+                                  a + i * n + k1);
+        }
+
+      for (size_t i = k1; i < n; ++i)
+        {
+          float *row = a + i * n;
+          size_t k = k0;
+          for (; k + 4 <= k1; k += 4)
+            {
+              const float *u[4] = { a + k * n + k1, a + (k + 1) * n + k1,
+                                    a + (k + 2) * n + k1,
+                                    a + (k + 3) * n + k1 };
+              sub_scaled_rows4_float (n - k1, row + k, u, row + k1);
+            }
+          for (; k < k1; ++k)
+            sub_scaled_row_float (n - k1, row[k], a + k * n + k1, row + k1);
+        }
+    }
+}
+
+void
+rxi_linalg_LU_svx_float (const size_t n, const float *lu,
+                         const gsl_permutation *p, gsl_vector *x)
+{
+  ASSERT ((n == p->size) && (n == x->size) && "Sizes mismatch");
+
+  double y[n];
+  for (size_t i = 0; i < n; ++i)
+    y[i] = gsl_vector_get (x, gsl_permutation_get (p, i));
+
+  for (size_t i = 0; i < n; ++i)
+    {
+      double sum = y[i];
+      for (size_t j = 0; j < i; ++j)
+        sum -= lu[i * n + j] * y[j];
+      y[i] = sum;
+    }
+  for (size_t i = n; i-- > 0;)
+    {
+      double sum = y[i];
+      for (size_t j = i + 1; j < n; ++j)
+        sum -= lu[i * n + j] * y[j];
+      y[i] = sum / lu[i * n + i];
+    }
+
+  for (size_t i = 0; i < n; ++i)
+    gsl_vector_set (x, i, y[i]);
+}
+
+bool
+rxi_linalg_refine_with (const gsl_matrix *a,
+                        void (*solve) (void *ctx, gsl_vector *v), void *ctx,
+                        const gsl_vector *b, gsl_vector *x, gsl_vector *resid,
+                        unsigned int *steps)
+{
+  const size_t n = a->size1;
+
+  // Stopping criterion of LAPACK `dsgesv`: backward error of the order of
+  // double precision
+  double a_norm = 0;
+  for (size_t i = 0; i < n; ++i)
+    {
+      const double *row = gsl_matrix_const_ptr (a, i, 0);
+      double sum = 0;
+      for (size_t j = 0; j < n; ++j)
+        sum += fabs (row[j]);
+      a_norm = fmax (a_norm, sum);
+    }
+  const double tol = RXI_REFINE_TOL * sqrt (n) * a_norm;
+
+  gsl_vector_memcpy (x, b);
+  solve (ctx, x);
+  double prev_corr = INFINITY;
+  for (*steps = 0;; ++*steps)
+    {
+      // Residual in double precision
+      gsl_vector_memcpy (resid, b);
+      gsl_blas_dgemv (CblasNoTrans, -1, a, x, 1, resid);
+
+      double resid_norm = 0;
+      double x_norm = 0;
+      bool finite = true;
+      for (size_t i = 0; i < n; ++i)
+        {
+          const double r_i = gsl_vector_get (resid, i);
+          const double x_i = gsl_vector_get (x, i);
+          finite &= isfinite (r_i) && isfinite (x_i);
+          resid_norm = fmax (resid_norm, fabs (r_i));
+          x_norm = fmax (x_norm, fabs (x_i));
+        }
+
+      // Zero pivots of approximate factors give infinities
+      if (!finite)
+        return false;
+      if (resid_norm <= tol * x_norm)
+        return true;
+      if (*steps == RXI_REFINE_MAX)
+        return false;
+
+      // Correction from the approximate solver
+      solve (ctx, resid);
+      double corr = 0;
+      for (size_t i = 0; i < n; ++i)
+        corr = fmax (corr, fabs (gsl_vector_get (resid, i)));
+      gsl_vector_add (x, resid);
+
+      // Contraction too slow: the approximation is too far from `a`
+      if (corr > 0.5 * prev_corr)
+        return false;
+      prev_corr = corr;
+    }
+}
+
+// Factors of `rxi_linalg_LU_decomp_float()` for `rxi_linalg_refine_with()`
+struct float_factors
+{
+  const float *lu;
+  const gsl_permutation *p;
+};
+
+static void
+solve_float (void *ctx, gsl_vector *v)
+{
+  const struct float_factors *f = ctx;
+  rxi_linalg_LU_svx_float (v->size, f->lu, f->p, v);
+}
+
+bool
+rxi_linalg_refine (const gsl_matrix *a, const float *lu,
+                   const gsl_permutation *p, const gsl_vector *b,
+                   gsl_vector *x, gsl_vector *resid, unsigned int *steps)
+{
+  struct float_factors f = { lu, p };
+  return rxi_linalg_refine_with (a, solve_float, &f, b, x, resid, steps);
+}
@@ -0,0 +1,113 @@
+/**
+ * @file core/linalg.h
+ * @brief LU decomposition backends for the rate equations.
+ */
+
+#ifndef RXI_LINALG_H
+#define RXI_LINALG_H
+
+#include <stdbool.h>
+#include <float.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_permutation.h>
+
+#include "rxi_common.h"
+
+//! Largest number of iterative refinement steps of `rxi_linalg_refine()`.
+#define RXI_REFINE_MAX 10
+
+//! Refinement stops when the residual is below `RXI_REFINE_TOL * sqrt (n)`
+//! of `|a| |x|` (infinity norms) for a system of size `n`.
+#define RXI_REFINE_TOL DBL_EPSILON
+
+/// @brief Whether LU backend is compiled in.
+///
+/// `LB_LAPACK` is only available when built with `RXI_USE_LAPACK` defined
+/// (`make LAPACK=1`).
+/// @param backend -- LU backend to check.
+/// @return `true` if @p backend can be used.
+bool rxi_linalg_has_backend (const LU_BACKEND backend);
+
+/// @brief LU decomposition with partial pivoting in place.
+///
+/// Every backend leaves factors in the layout of `gsl_linalg_LU_decomp()`,
+/// so `gsl_linalg_LU_solve()` and `gsl_linalg_LU_svx()` solve with them
+/// regardless of the backend.
+/// @param backend -- implementation to use; falls back to `LB_GSL` if it
+/// isn't compiled in;
+/// @param *a -- square matrix, replaced by its factors;
+/// @param *p -- permutation of the same size, replaced by row pivots.
+void rxi_linalg_LU_decomp (const LU_BACKEND backend, gsl_matrix *a,
+                           gsl_permutation *p);
+
+/// @brief Scales rows and columns of a square matrix in place.
+///
+/// Row and column factors are powers of two, so that the largest element of
+/// every row and column of the scaled matrix is in [0.5, 1) and scaling
+/// itself is exact. A system `a x = b` becomes `(R a C) y = R b` with
+/// `x = C y`.
+/// @param *a -- matrix, replaced by `R a C`;
+/// @param *r -- row factors, diagonal of `R`, are written here;
+/// @param *c -- column factors, diagonal of `C`, are written here.
+void rxi_linalg_equilibrate (gsl_matrix *a, gsl_vector *r, gsl_vector *c);
+
+/// @brief LU decomposition with partial pivoting in single precision.
+///
+/// Factors are stored as by `rxi_linalg_LU_decomp()`, but in a dense
+/// row-major array of floats, which halves memory traffic of the
+/// decomposition.
+/// @param n -- size of the matrix;
+/// @param *a -- matrix of `n * n` elements, replaced by its factors;
+/// @param *p -- permutation of size @p n, replaced by row pivots.
+void rxi_linalg_LU_decomp_float (const size_t n, float *a,
+                                 gsl_permutation *p);
+
+/// @brief Solves a system with factors of `rxi_linalg_LU_decomp_float()`.
+///
+/// Substitutions are done in double precision.
+/// @param n -- size of the system;
+/// @param *lu -- LU factors;
+/// @param *p -- row pivots;
+/// @param *x -- right-hand side, replaced by the solution.
+void rxi_linalg_LU_svx_float (const size_t n, const float *lu,
+                              const gsl_permutation *p, gsl_vector *x);
+
+/// @brief Solves `a x = b` to double precision by iterative refinement.
+///
+/// Starts from the solution with single precision factors of @p a and
+/// corrects it with residuals computed in double precision, until the
+/// backward error drops to the order of double precision (see
+/// `RXI_REFINE_TOL`).
+/// @param *a -- matrix of the system;
+/// @param *lu, *p -- factors of @p a by `rxi_linalg_LU_decomp_float()`;
+/// @param *b -- right-hand side;
+/// @param *x -- solution is written here;
+/// @param *resid -- vector of the system size for intermediate results;
+/// @param *steps -- number of refinement steps is written here.
+/// @return `false` if refinement doesn't converge, e.g. for a matrix too
+/// ill-conditioned for single precision; @p x is not usable then.
+bool rxi_linalg_refine (const gsl_matrix *a, const float *lu,
+                        const gsl_permutation *p, const gsl_vector *b,
+                        gsl_vector *x, gsl_vector *resid,
+                        unsigned int *steps);
+
+/// @brief Iterative refinement of `rxi_linalg_refine()` with any approximate
+/// solver for @p a.
+///
+/// Stops by the same criterion, and also fails if corrections don't shrink
+/// at least twice on every step.
+/// @param *a -- matrix of the system;
+/// @param solve -- replaces its vector argument by an approximation of the
+/// solution of the system with it as the right-hand side;
+/// @param *ctx -- passed to @p solve as its first argument;
+/// @param *b -- right-hand side;
+/// @param *x -- solution is written here;
+/// @param *resid -- vector of the system size for intermediate results;
+/// @param *steps -- number of refinement steps is written here.
+/// @return `false` if refinement doesn't converge; @p x is not usable then.
+bool rxi_linalg_refine_with (const gsl_matrix *a,
+                             void (*solve) (void *ctx, gsl_vector *v),
+                             void *ctx, const gsl_vector *b, gsl_vector *x,
+                             gsl_vector *resid, unsigned int *steps);
+
+#endif  // RXI_LINALG_H
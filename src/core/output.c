@@ -50,7 +50,21 @@ rxi_out_print (struct rxi_calc_data **data,
   printf ("* Geometry                   : %s\n", geometry);
   free (geometry);
   for (int i = 0; i < data[0]->input.numof_molecules; ++i)
-    printf ("* Molecule                   : %s\n", data[i]->input.name);
+    {
+      printf ("* Molecule                   : %s\n", data[i]->input.name);
+      printf ("* Solver iterations          : %u\n", data[i]->numof_iter);
+      if (data[i]->input.solver.linear_solver == LS_GMRES)
+        printf ("* GMRES residual             : %.3e\n",
+                data[i]->linear_residual);
+      if (data[i]->input.solver.adaptive_relax && (data[i]->relax > 0))
+        printf ("* Relaxation weight          : %.3f\n", data[i]->relax);
+      if (data[i]->input.solver.method == SM_NEWTON)
+        printf ("* Newton fallbacks           : %u\n",
+                data[i]->numof_fallbacks);
+      if (data[i]->fast_path != FP_NONE)
+        printf ("* Fast path                  : %s\n",
+                data[i]->fast_path == FP_LTE ? "LTE" : "thin");
+    }
   printf ("* Kinetic temperature    [K] : %.3f\n", data[0]->input.temp_kin);
   printf ("* Background temperature [K] : %.3f\n", data[0]->input.temp_bg);
   printf ("* Column density      [cm-2] : %.3e\n", data[0]->input.col_dens);
@@ -156,16 +170,12 @@ rxi_out_result (struct rxi_calc_data *data[RXI_MOLECULE_MAX],
           output[k].up = data[i]->up[j];
           output[k].low = data[i]->low[j];
           strcpy (output[k].name, data[i]->input.name);
-          output[k].spfreq = gsl_matrix_get (data[i]->freq, output[k].up - 1,
-                                             output[k].low - 1);
+          output[k].spfreq = gsl_vector_get (data[i]->freq, j);
           output[k].xnu = gsl_vector_get (data[i]->term, output[k].up - 1)
                           - gsl_vector_get (data[i]->term, output[k].low - 1);
-          output[k].tau = gsl_matrix_get (data[i]->tau, output[k].up - 1,
-                                          output[k].low - 1);
-          output[k].excit_temp =  gsl_matrix_get (data[i]->excit_temp,
-              output[k].up - 1, output[k].low - 1);
-          output[k].antenna_temp =  gsl_matrix_get (data[i]->antenna_temp,
-              output[k].up - 1, output[k].low - 1);
+          output[k].tau = gsl_vector_get (data[i]->tau, j);
+          output[k].excit_temp = gsl_vector_get (data[i]->excit_temp, j);
+          output[k].antenna_temp = gsl_vector_get (data[i]->antenna_temp, j);
           ++k;
         }
     }
@@ -222,6 +232,20 @@ rxi_out_result (struct rxi_calc_data *data[RXI_MOLECULE_MAX],
     {
       fprintf (result_file, "* Molecule                   : %s\n",
                data[i]->input.name);
+      fprintf (result_file, "* Solver iterations          : %u\n",
+               data[i]->numof_iter);
+      if (data[i]->input.solver.linear_solver == LS_GMRES)
+        fprintf (result_file, "* GMRES residual             : %.3e\n",
+                 data[i]->linear_residual);
+      if (data[i]->input.solver.adaptive_relax && (data[i]->relax > 0))
+        fprintf (result_file, "* Relaxation weight          : %.3f\n",
+                 data[i]->relax);
+      if (data[i]->input.solver.method == SM_NEWTON)
+        fprintf (result_file, "* Newton fallbacks           : %u\n",
+                 data[i]->numof_fallbacks);
+      if (data[i]->fast_path != FP_NONE)
+        fprintf (result_file, "* Fast path                  : %s\n",
+                 data[i]->fast_path == FP_LTE ? "LTE" : "thin");
     }
   fprintf (result_file, "* Kinetic temperature    [K] : %.3f\n",
            data[0]->input.temp_kin);
@@ -108,6 +108,7 @@ usage_dialogue (const struct rxi_options *opts)
       free (inp_data);
       return stat;
     }
+  inp_data->solver = opts->solver;
 
   struct rxi_db_molecule_info *info[inp_data->numof_molecules];
   struct rxi_calc_data *calc_data[RXI_MOLECULE_MAX];
@@ -156,8 +157,20 @@ usage_dialogue (const struct rxi_options *opts)
           return stat;
         }
 
-      stat = rxi_calc_find_rates (calc_data[i], info[i]->numof_enlev,
+      struct rxi_calc_workspace *work;
+      stat = rxi_calc_workspace_malloc (&work, info[i]->numof_enlev);
+      CHECK ((stat == RXI_OK) && "Workspace memory allocation error");
+      if (stat != RXI_OK)
+        {
+          free (inp_data);
+          rxi_db_molecule_info_free (info[i]);
+          rxi_calc_data_free (calc_data[i]);
+          return stat;
+        }
+
+      stat = rxi_calc_find_rates (calc_data[i], work, info[i]->numof_enlev,
                                   info[i]->numof_radtr);
+      rxi_calc_workspace_free (work);
       CHECK ((stat == RXI_OK) && "Error in rates calculation");
       if (stat != RXI_OK)
         {
@@ -195,6 +208,7 @@ usage_find_good_fit (const struct rxi_options *opts)
       free (inp_data);
       return stat;
     }
+  inp_data->solver = opts->solver;
 
   stat = rxi_calc_data_malloc (&calc_data, info->numof_enlev, info->numof_radtr);
   CHECK ((stat == RXI_OK) && "Calculation data memory allocation error");
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_matrix.h>
 
@@ -438,7 +439,7 @@ rxi_calc_data_malloc (struct rxi_calc_data **calc_data, const size_t n_enlev,
       goto malloc_error;
     }
 
-  gsl_matrix *einst = gsl_matrix_calloc (n_enlev, n_enlev);
+  gsl_vector *einst = gsl_vector_calloc (n_radtr);
   CHECK (einst && "Allocation error");
   if (!einst)
     {
@@ -448,14 +449,14 @@ rxi_calc_data_malloc (struct rxi_calc_data **calc_data, const size_t n_enlev,
       goto malloc_error;
     }
 
-  gsl_matrix *energy = gsl_matrix_calloc (n_enlev, n_enlev);
+  gsl_vector *energy = gsl_vector_calloc (n_radtr);
   CHECK (energy && "Allocation error");
   if (!energy)
     {
       free (cd);
       gsl_vector_free (term);
       gsl_vector_free (weight);
-      gsl_matrix_free (einst);
+      gsl_vector_free (einst);
       goto malloc_error;
     }
 
@@ -467,8 +468,8 @@ rxi_calc_data_malloc (struct rxi_calc_data **calc_data, const size_t n_enlev,
       free (cd);
       gsl_vector_free (term);
       gsl_vector_free (weight);
-      gsl_matrix_free (einst);
-      gsl_matrix_free (energy);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
       goto malloc_error;
     }
 
@@ -479,8 +480,8 @@ rxi_calc_data_malloc (struct rxi_calc_data **calc_data, const size_t n_enlev,
       free (cd);
       gsl_vector_free (term);
       gsl_vector_free (weight);
-      gsl_matrix_free (einst);
-      gsl_matrix_free (energy);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
       gsl_matrix_free (rates);
       goto malloc_error;
     }
@@ -492,8 +493,8 @@ rxi_calc_data_malloc (struct rxi_calc_data **calc_data, const size_t n_enlev,
       free (cd);
       gsl_vector_free (term);
       gsl_vector_free (weight);
-      gsl_matrix_free (einst);
-      gsl_matrix_free (energy);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
       gsl_matrix_free (rates);
       gsl_matrix_free (coll_rates);
       goto malloc_error;
@@ -506,23 +507,23 @@ rxi_calc_data_malloc (struct rxi_calc_data **calc_data, const size_t n_enlev,
       free (cd);
       gsl_vector_free (term);
       gsl_vector_free (weight);
-      gsl_matrix_free (einst);
-      gsl_matrix_free (energy);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
       gsl_matrix_free (rates);
       gsl_matrix_free (coll_rates);
       gsl_vector_free (tot_rates);
       goto malloc_error;
     }
 
-  gsl_matrix *tau = gsl_matrix_calloc (n_enlev, n_enlev);
+  gsl_vector *tau = gsl_vector_calloc (n_radtr);
   CHECK (tau && "Allocation error");
   if (!tau)
     {
       free (cd);
       gsl_vector_free (term);
       gsl_vector_free (weight);
-      gsl_matrix_free (einst);
-      gsl_matrix_free (energy);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
       gsl_matrix_free (rates);
       gsl_matrix_free (coll_rates);
       gsl_vector_free (tot_rates);
@@ -530,77 +531,200 @@ rxi_calc_data_malloc (struct rxi_calc_data **calc_data, const size_t n_enlev,
       goto malloc_error;
     }
 
-  gsl_matrix *bgfield = gsl_matrix_calloc (n_enlev, n_enlev);
+  gsl_vector *bgfield = gsl_vector_calloc (n_radtr);
   CHECK (bgfield && "Allocation error");
   if (!bgfield)
     {
       free (cd);
       gsl_vector_free (term);
       gsl_vector_free (weight);
-      gsl_matrix_free (einst);
-      gsl_matrix_free (energy);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
       gsl_matrix_free (rates);
       gsl_matrix_free (coll_rates);
       gsl_vector_free (tot_rates);
       gsl_vector_free (pop);
-      gsl_matrix_free (tau);
+      gsl_vector_free (tau);
       goto malloc_error;
     }
 
-  gsl_matrix *excit_temp = gsl_matrix_calloc (n_enlev, n_enlev);
+  gsl_vector *excit_temp = gsl_vector_calloc (n_radtr);
   CHECK (excit_temp && "Allocation error");
   if (!excit_temp)
     {
       free (cd);
       gsl_vector_free (term);
       gsl_vector_free (weight);
-      gsl_matrix_free (einst);
-      gsl_matrix_free (energy);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
       gsl_matrix_free (rates);
       gsl_matrix_free (coll_rates);
       gsl_vector_free (tot_rates);
       gsl_vector_free (pop);
-      gsl_matrix_free (tau);
-      gsl_matrix_free (bgfield);
+      gsl_vector_free (tau);
+      gsl_vector_free (bgfield);
       goto malloc_error;
     }
 
-  gsl_matrix *antenna_temp = gsl_matrix_calloc (n_enlev, n_enlev);
+  gsl_vector *antenna_temp = gsl_vector_calloc (n_radtr);
   CHECK (antenna_temp && "Allocation error");
   if (!antenna_temp)
     {
       free (cd);
       gsl_vector_free (term);
       gsl_vector_free (weight);
-      gsl_matrix_free (einst);
-      gsl_matrix_free (energy);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
       gsl_matrix_free (rates);
       gsl_matrix_free (coll_rates);
       gsl_vector_free (tot_rates);
       gsl_vector_free (pop);
-      gsl_matrix_free (tau);
-      gsl_matrix_free (bgfield);
-      gsl_matrix_free (excit_temp);
+      gsl_vector_free (tau);
+      gsl_vector_free (bgfield);
+      gsl_vector_free (excit_temp);
       goto malloc_error;
     }
 
-  gsl_matrix *radiation_temp = gsl_matrix_calloc (n_enlev, n_enlev);
+  gsl_vector *radiation_temp = gsl_vector_calloc (n_radtr);
   CHECK (radiation_temp && "Allocation error");
   if (!radiation_temp)
     {
       free (cd);
       gsl_vector_free (term);
       gsl_vector_free (weight);
-      gsl_matrix_free (einst);
-      gsl_matrix_free (energy);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
       gsl_matrix_free (rates);
       gsl_matrix_free (coll_rates);
       gsl_vector_free (tot_rates);
       gsl_vector_free (pop);
-      gsl_matrix_free (tau);
-      gsl_matrix_free (bgfield);
-      gsl_matrix_free (excit_temp);
-      gsl_matrix_free (antenna_temp);
+      gsl_vector_free (tau);
+      gsl_vector_free (bgfield);
+      gsl_vector_free (excit_temp);
+      gsl_vector_free (antenna_temp);
+      goto malloc_error;
+    }
+
+  gsl_vector *beta = gsl_vector_calloc (n_radtr);
+  CHECK (beta && "Allocation error");
+  if (!beta)
+    {
+      free (cd);
+      gsl_vector_free (term);
+      gsl_vector_free (weight);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
+      gsl_matrix_free (rates);
+      gsl_matrix_free (coll_rates);
+      gsl_vector_free (tot_rates);
+      gsl_vector_free (pop);
+      gsl_vector_free (tau);
+      gsl_vector_free (bgfield);
+      gsl_vector_free (excit_temp);
+      gsl_vector_free (antenna_temp);
+      gsl_vector_free (radiation_temp);
+      goto malloc_error;
+    }
+
+  gsl_vector *boltz = gsl_vector_calloc (n_enlev);
+  CHECK (boltz && "Allocation error");
+  if (!boltz)
+    {
+      free (cd);
+      gsl_vector_free (term);
+      gsl_vector_free (weight);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
+      gsl_matrix_free (rates);
+      gsl_matrix_free (coll_rates);
+      gsl_vector_free (tot_rates);
+      gsl_vector_free (pop);
+      gsl_vector_free (tau);
+      gsl_vector_free (bgfield);
+      gsl_vector_free (excit_temp);
+      gsl_vector_free (antenna_temp);
+      gsl_vector_free (radiation_temp);
+      gsl_vector_free (beta);
+      goto malloc_error;
+    }
+
+  struct rxi_calc_lines lines = {
+    .up = malloc (n_radtr * sizeof (*lines.up)),
+    .low = malloc (n_radtr * sizeof (*lines.low)),
+    .einst = malloc (n_radtr * sizeof (*lines.einst)),
+    .weight_ratio = malloc (n_radtr * sizeof (*lines.weight_ratio)),
+    .energy = malloc (n_radtr * sizeof (*lines.energy)),
+    .occ_norm = malloc (n_radtr * sizeof (*lines.occ_norm))
+  };
+  CHECK (lines.up && lines.low && lines.einst && lines.weight_ratio
+         && lines.energy && lines.occ_norm && "Allocation error");
+  if (!lines.up || !lines.low || !lines.einst || !lines.weight_ratio
+      || !lines.energy || !lines.occ_norm)
+    {
+      free (cd);
+      free (up);
+      free (low);
+      gsl_vector_free (term);
+      gsl_vector_free (weight);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
+      gsl_matrix_free (rates);
+      gsl_matrix_free (rates_archive);
+      gsl_matrix_free (coll_rates);
+      gsl_vector_free (tot_rates);
+      gsl_vector_free (pop);
+      gsl_vector_free (tau);
+      gsl_vector_free (bgfield);
+      gsl_vector_free (excit_temp);
+      gsl_vector_free (antenna_temp);
+      gsl_vector_free (radiation_temp);
+      gsl_vector_free (beta);
+      gsl_vector_free (boltz);
+      free (lines.up);
+      free (lines.low);
+      free (lines.einst);
+      free (lines.weight_ratio);
+      free (lines.energy);
+      free (lines.occ_norm);
+      goto malloc_error;
+    }
+
+  size_t *active = malloc (n_radtr * sizeof (*active));
+  double *active_tau = malloc (n_radtr * sizeof (*active_tau));
+  double *active_beta = malloc (n_radtr * sizeof (*active_beta));
+  struct rxi_calc_coll *coll = malloc (sizeof (*coll));
+  CHECK ((active && active_tau && active_beta && coll) && "Allocation error");
+  if (!active || !active_tau || !active_beta || !coll)
+    {
+      free (cd);
+      free (up);
+      free (low);
+      gsl_vector_free (term);
+      gsl_vector_free (weight);
+      gsl_vector_free (einst);
+      gsl_vector_free (energy);
+      gsl_matrix_free (rates);
+      gsl_matrix_free (rates_archive);
+      gsl_matrix_free (coll_rates);
+      gsl_vector_free (tot_rates);
+      gsl_vector_free (pop);
+      gsl_vector_free (tau);
+      gsl_vector_free (bgfield);
+      gsl_vector_free (excit_temp);
+      gsl_vector_free (antenna_temp);
+      gsl_vector_free (radiation_temp);
+      gsl_vector_free (beta);
+      gsl_vector_free (boltz);
+      free (lines.up);
+      free (lines.low);
+      free (lines.einst);
+      free (lines.weight_ratio);
+      free (lines.energy);
+      free (lines.occ_norm);
+      free (active);
+      free (active_tau);
+      free (active_beta);
+      free (coll);
       goto malloc_error;
     }
 
@@ -616,9 +740,22 @@ rxi_calc_data_malloc (struct rxi_calc_data **calc_data, const size_t n_enlev,
   cd->rates = rates;
   cd->rates_archive = rates_archive;
   cd->tot_rates = tot_rates;
+  cd->boltz = boltz;
   cd->tau = tau;
+  cd->beta = beta;
   cd->pop = pop;
   cd->bgfield = bgfield;
+  cd->lines = lines;
+  cd->active = active;
+  cd->numof_active = 0;
+  cd->active_tau = active_tau;
+  cd->active_beta = active_beta;
+  *coll = (struct rxi_calc_coll) { .temp_kin = NAN, .refs = 1 };
+  cd->coll = coll;
+  cd->ready = 0;
+  cd->fast_path = FP_NONE;
+  cd->relax = 0;
+  cd->numof_fallbacks = 0;
   cd->excit_temp = excit_temp;
   cd->antenna_temp = antenna_temp;
   cd->radiation_temp = radiation_temp;
@@ -632,6 +769,24 @@ malloc_error:
   return RXI_ERR_ALLOC;
 }
 
+void
+rxi_calc_coll_release (struct rxi_calc_coll *coll)
+{
+  if (--coll->refs > 0)
+    return;
+
+  for (int8_t p = 0; p < coll->numof_parts; ++p)
+    {
+      rxi_db_molecule_coll_part_free (coll->table[p]);
+      free (coll->coefs[p]);
+      free (coll->bracket_base[p]);
+      free (coll->bracket_slope[p]);
+      gsl_matrix_free (coll->unit_rates[p]);
+      gsl_vector_free (coll->unit_tot[p]);
+    }
+  free (coll);
+}
+
 void
 rxi_calc_data_free (struct rxi_calc_data *calc_data)
 {
@@ -640,15 +795,395 @@ rxi_calc_data_free (struct rxi_calc_data *calc_data)
   free (calc_data->low);
   gsl_vector_free (calc_data->term);
   gsl_vector_free (calc_data->weight);
-  gsl_matrix_free (calc_data->einst);
-  gsl_matrix_free (calc_data->freq);
+  gsl_vector_free (calc_data->einst);
+  gsl_vector_free (calc_data->freq);
   gsl_matrix_free (calc_data->coll_rates);
   gsl_matrix_free (calc_data->rates);
   gsl_matrix_free (calc_data->rates_archive);
   gsl_vector_free (calc_data->tot_rates);
+  gsl_vector_free (calc_data->boltz);
+  gsl_vector_free (calc_data->bgfield);
+  free (calc_data->lines.up);
+  free (calc_data->lines.low);
+  free (calc_data->lines.einst);
+  free (calc_data->lines.weight_ratio);
+  free (calc_data->lines.energy);
+  free (calc_data->lines.occ_norm);
+  free (calc_data->active);
+  free (calc_data->active_tau);
+  free (calc_data->active_beta);
+  rxi_calc_coll_release (calc_data->coll);
   gsl_vector_free (calc_data->pop);
-  gsl_matrix_free (calc_data->tau);
-  gsl_matrix_free (calc_data->excit_temp);
+  gsl_vector_free (calc_data->tau);
+  gsl_vector_free (calc_data->beta);
+  gsl_vector_free (calc_data->excit_temp);
+  gsl_vector_free (calc_data->antenna_temp);
+  gsl_vector_free (calc_data->radiation_temp);
+  free (calc_data);
+}
+
+RXI_STAT
+rxi_calc_lowrank_malloc (struct rxi_calc_lowrank **lowrank,
+                         const size_t n_enlev, const size_t n_radtr,
+                         const size_t max_rank)
+{
+  DEBUG ("Allocate memory for low-rank updates of rank %zu", max_rank);
+  struct rxi_calc_lowrank *lr = malloc (sizeof (*lr));
+  CHECK (lr && "Allocation error");
+  if (!lr)
+    goto malloc_error;
+
+  lr->numof_enlev = n_enlev;
+  lr->numof_radtr = n_radtr;
+  lr->max_rank = max_rank;
+  lr->rank = 0;
+  lr->numof_updates = 0;
+  lr->numof_factorizations = 0;
+  lr->emission = calloc (n_radtr, sizeof (*lr->emission));
+  lr->absorption = calloc (n_radtr, sizeof (*lr->absorption));
+  lr->row = calloc (n_radtr, sizeof (*lr->row));
+  lr->line = calloc (max_rank, sizeof (*lr->line));
+  lr->z = calloc (max_rank * n_enlev, sizeof (*lr->z));
+  lr->d_emission = calloc (max_rank, sizeof (*lr->d_emission));
+  lr->d_absorption = calloc (max_rank, sizeof (*lr->d_absorption));
+  lr->cap = calloc (max_rank * max_rank, sizeof (*lr->cap));
+  lr->cap_perm = calloc (max_rank, sizeof (*lr->cap_perm));
+  lr->cap_rhs = calloc (max_rank, sizeof (*lr->cap_rhs));
+  CHECK (lr->emission && lr->absorption && lr->row && lr->line && lr->z
+         && lr->d_emission && lr->d_absorption && lr->cap && lr->cap_perm
+         && lr->cap_rhs && "Allocation error");
+  if (!lr->emission || !lr->absorption || !lr->row || !lr->line || !lr->z
+      || !lr->d_emission || !lr->d_absorption || !lr->cap || !lr->cap_perm
+      || !lr->cap_rhs)
+    {
+      rxi_calc_lowrank_free (lr);
+      goto malloc_error;
+    }
+
+  *lowrank = lr;
+
+  return RXI_OK;
+
+malloc_error:
+  *lowrank = NULL;
+  return RXI_ERR_ALLOC;
+}
+
+void
+rxi_calc_lowrank_free (struct rxi_calc_lowrank *lowrank)
+{
+  DEBUG ("Free memory for low-rank updates");
+  free (lowrank->emission);
+  free (lowrank->absorption);
+  free (lowrank->row);
+  free (lowrank->line);
+  free (lowrank->z);
+  free (lowrank->d_emission);
+  free (lowrank->d_absorption);
+  free (lowrank->cap);
+  free (lowrank->cap_perm);
+  free (lowrank->cap_rhs);
+  free (lowrank);
+}
+
+RXI_STAT
+rxi_calc_workspace_malloc (struct rxi_calc_workspace **work,
+                           const size_t n_enlev)
+{
+  DEBUG ("Allocating memory for solver workspace");
+  struct rxi_calc_workspace *cw = malloc (sizeof (*cw));
+  CHECK (cw && "Allocation error");
+  if (!cw)
+    goto malloc_error;
+
+  gsl_vector *b = gsl_vector_calloc (n_enlev);
+  CHECK (b && "Allocation error");
+  if (!b)
+    {
+      free (cw);
+      goto malloc_error;
+    }
+
+  gsl_vector *x = gsl_vector_calloc (n_enlev);
+  CHECK (x && "Allocation error");
+  if (!x)
+    {
+      free (cw);
+      gsl_vector_free (b);
+      goto malloc_error;
+    }
+
+  gsl_vector *prev_pop = gsl_vector_calloc (n_enlev);
+  CHECK (prev_pop && "Allocation error");
+  if (!prev_pop)
+    {
+      free (cw);
+      gsl_vector_free (b);
+      gsl_vector_free (x);
+      goto malloc_error;
+    }
+
+  gsl_permutation *perm = gsl_permutation_alloc (n_enlev);
+  CHECK (perm && "Allocation error");
+  if (!perm)
+    {
+      free (cw);
+      gsl_vector_free (b);
+      gsl_vector_free (x);
+      gsl_vector_free (prev_pop);
+      goto malloc_error;
+    }
+
+  gsl_matrix *ng_hist = gsl_matrix_calloc (RXI_NG_HISTORY, n_enlev);
+  CHECK (ng_hist && "Allocation error");
+  if (!ng_hist)
+    {
+      free (cw);
+      gsl_vector_free (b);
+      gsl_vector_free (x);
+      gsl_vector_free (prev_pop);
+      gsl_permutation_free (perm);
+      goto malloc_error;
+    }
+
+  gsl_vector *ng_backup = gsl_vector_calloc (n_enlev);
+  CHECK (ng_backup && "Allocation error");
+  if (!ng_backup)
+    {
+      free (cw);
+      gsl_vector_free (b);
+      gsl_vector_free (x);
+      gsl_vector_free (prev_pop);
+      gsl_permutation_free (perm);
+      gsl_matrix_free (ng_hist);
+      goto malloc_error;
+    }
+
+  gsl_vector *warm_pop = gsl_vector_calloc (n_enlev);
+  CHECK (warm_pop && "Allocation error");
+  if (!warm_pop)
+    {
+      free (cw);
+      gsl_vector_free (b);
+      gsl_vector_free (x);
+      gsl_vector_free (prev_pop);
+      gsl_permutation_free (perm);
+      gsl_matrix_free (ng_hist);
+      gsl_vector_free (ng_backup);
+      goto malloc_error;
+    }
+
+  gsl_matrix *precond = gsl_matrix_calloc (n_enlev, n_enlev);
+  gsl_permutation *precond_perm = gsl_permutation_alloc (n_enlev);
+  gsl_matrix *krylov = gsl_matrix_calloc (RXI_GMRES_RESTART + 1, n_enlev);
+  gsl_matrix *hess = gsl_matrix_calloc (RXI_GMRES_RESTART + 1,
+                                        RXI_GMRES_RESTART);
+  gsl_vector *givens_cos = gsl_vector_calloc (RXI_GMRES_RESTART);
+  gsl_vector *givens_sin = gsl_vector_calloc (RXI_GMRES_RESTART);
+  gsl_vector *lsq_rhs = gsl_vector_calloc (RXI_GMRES_RESTART + 1);
+  CHECK (precond && precond_perm && krylov && hess && givens_cos && givens_sin
+         && lsq_rhs && "Allocation error");
+  if (!precond || !precond_perm || !krylov || !hess || !givens_cos
+      || !givens_sin || !lsq_rhs)
+    {
+      free (cw);
+      gsl_vector_free (b);
+      gsl_vector_free (x);
+      gsl_vector_free (prev_pop);
+      gsl_permutation_free (perm);
+      gsl_matrix_free (ng_hist);
+      gsl_vector_free (ng_backup);
+      gsl_vector_free (warm_pop);
+      gsl_matrix_free (precond);
+      gsl_permutation_free (precond_perm);
+      gsl_matrix_free (krylov);
+      gsl_matrix_free (hess);
+      gsl_vector_free (givens_cos);
+      gsl_vector_free (givens_sin);
+      gsl_vector_free (lsq_rhs);
+      goto malloc_error;
+    }
+
+  gsl_vector *row_scale = gsl_vector_calloc (n_enlev);
+  gsl_vector *col_scale = gsl_vector_calloc (n_enlev);
+  float *rates_float = calloc (n_enlev * n_enlev, sizeof (*rates_float));
+  gsl_vector *resid = gsl_vector_calloc (n_enlev);
+  CHECK (row_scale && col_scale && rates_float && resid
+         && "Allocation error");
+  if (!row_scale || !col_scale || !rates_float || !resid)
+    {
+      free (cw);
+      gsl_vector_free (b);
+      gsl_vector_free (x);
+      gsl_vector_free (prev_pop);
+      gsl_permutation_free (perm);
+      gsl_matrix_free (ng_hist);
+      gsl_vector_free (ng_backup);
+      gsl_vector_free (warm_pop);
+      gsl_matrix_free (precond);
+      gsl_permutation_free (precond_perm);
+      gsl_matrix_free (krylov);
+      gsl_matrix_free (hess);
+      gsl_vector_free (givens_cos);
+      gsl_vector_free (givens_sin);
+      gsl_vector_free (lsq_rhs);
+      gsl_vector_free (row_scale);
+      gsl_vector_free (col_scale);
+      free (rates_float);
+      gsl_vector_free (resid);
+      goto malloc_error;
+    }
+
+  cw->numof_enlev = n_enlev;
+  cw->b = b;
+  cw->x = x;
+  cw->prev_pop = prev_pop;
+  cw->perm = perm;
+  cw->ng_hist = ng_hist;
+  cw->ng_backup = ng_backup;
+  cw->warm_pop = warm_pop;
+  cw->has_warm_pop = false;
+  cw->precond = precond;
+  cw->precond_perm = precond_perm;
+  cw->has_precond = false;
+  cw->krylov = krylov;
+  cw->hess = hess;
+  cw->givens_cos = givens_cos;
+  cw->givens_sin = givens_sin;
+  cw->lsq_rhs = lsq_rhs;
+  cw->row_scale = row_scale;
+  cw->col_scale = col_scale;
+  cw->rates_float = rates_float;
+  cw->resid = resid;
+  cw->lowrank = NULL;
+  cw->trunc_data = NULL;
+  cw->trunc_work = NULL;
+
+  *work = cw;
+
+  return RXI_OK;
+
+malloc_error:
+  *work = NULL;
+  return RXI_ERR_ALLOC;
+}
+
+void
+rxi_calc_workspace_free (struct rxi_calc_workspace *work)
+{
+  DEBUG ("Free memory for solver workspace");
+  gsl_vector_free (work->b);
+  gsl_vector_free (work->x);
+  gsl_vector_free (work->prev_pop);
+  gsl_permutation_free (work->perm);
+  gsl_matrix_free (work->ng_hist);
+  gsl_vector_free (work->ng_backup);
+  gsl_vector_free (work->warm_pop);
+  gsl_matrix_free (work->precond);
+  gsl_permutation_free (work->precond_perm);
+  gsl_matrix_free (work->krylov);
+  gsl_matrix_free (work->hess);
+  gsl_vector_free (work->givens_cos);
+  gsl_vector_free (work->givens_sin);
+  gsl_vector_free (work->lsq_rhs);
+  gsl_vector_free (work->row_scale);
+  gsl_vector_free (work->col_scale);
+  free (work->rates_float);
+  gsl_vector_free (work->resid);
+  if (work->lowrank)
+    rxi_calc_lowrank_free (work->lowrank);
+  if (work->trunc_data)
+    rxi_calc_data_free (work->trunc_data);
+  if (work->trunc_work)
+    rxi_calc_workspace_free (work->trunc_work);
+  free (work);
+}
+
+RXI_STAT
+rxi_calc_batch_malloc (struct rxi_calc_batch **batch, const size_t n_enlev,
+                       const size_t n_radtr, const size_t n_lanes)
+{
+  DEBUG ("Allocate memory for batch of %zu models", n_lanes);
+  struct rxi_calc_batch *cb = malloc (sizeof (*cb));
+  CHECK (cb && "Allocation error");
+  if (!cb)
+    goto malloc_error;
+
+  const size_t lanes = (n_lanes + RXI_BATCH_STEP - 1)
+                       / RXI_BATCH_STEP * RXI_BATCH_STEP;
+  cb->numof_enlev = n_enlev;
+  cb->numof_radtr = n_radtr;
+  cb->numof_lanes = lanes;
+
+  cb->lane_data = calloc (lanes, sizeof (*cb->lane_data));
+  cb->lane_iter = calloc (lanes, sizeof (*cb->lane_iter));
+  cb->thick_lines = calloc (lanes, sizeof (*cb->thick_lines));
+  cb->stop_cond = calloc (lanes, sizeof (*cb->stop_cond));
+  cb->col_dens = calloc (lanes, sizeof (*cb->col_dens));
+  cb->line_width = calloc (lanes, sizeof (*cb->line_width));
+  cb->temp_bg = calloc (lanes, sizeof (*cb->temp_bg));
+  cb->geom = calloc (lanes, sizeof (*cb->geom));
+  cb->pivot_row = calloc (lanes, sizeof (*cb->pivot_row));
+  cb->lane_tmp = calloc (lanes, sizeof (*cb->lane_tmp));
+  cb->coll = calloc (n_enlev * n_enlev * lanes, sizeof (*cb->coll));
+  cb->rates = calloc (n_enlev * n_enlev * lanes, sizeof (*cb->rates));
+  cb->rhs = calloc (n_enlev * lanes, sizeof (*cb->rhs));
+  cb->pop = calloc (n_enlev * lanes, sizeof (*cb->pop));
+  cb->prev_pop = calloc (n_enlev * lanes, sizeof (*cb->prev_pop));
+  cb->bgfield = calloc (n_radtr * lanes, sizeof (*cb->bgfield));
+  cb->tau = calloc (n_radtr * lanes, sizeof (*cb->tau));
+  cb->beta = calloc (n_radtr * lanes, sizeof (*cb->beta));
+  cb->beta_geom = calloc (n_radtr * lanes, sizeof (*cb->beta_geom));
+  cb->excit_temp = calloc (n_radtr * lanes, sizeof (*cb->excit_temp));
+  CHECK (cb->lane_data && cb->lane_iter && cb->thick_lines && cb->stop_cond
+         && cb->col_dens && cb->line_width && cb->temp_bg && cb->geom
+         && cb->pivot_row && cb->lane_tmp && cb->coll && cb->rates && cb->rhs
+         && cb->pop && cb->prev_pop && cb->bgfield && cb->tau && cb->beta
+         && cb->beta_geom && cb->excit_temp && "Allocation error");
+  if (!cb->lane_data || !cb->lane_iter || !cb->thick_lines || !cb->stop_cond
+      || !cb->col_dens || !cb->line_width || !cb->temp_bg || !cb->geom
+      || !cb->pivot_row || !cb->lane_tmp || !cb->coll || !cb->rates
+      || !cb->rhs || !cb->pop || !cb->prev_pop || !cb->bgfield || !cb->tau
+      || !cb->beta || !cb->beta_geom || !cb->excit_temp)
+    {
+      rxi_calc_batch_free (cb);
+      goto malloc_error;
+    }
+
+  *batch = cb;
+
+  return RXI_OK;
+
+malloc_error:
+  *batch = NULL;
+  return RXI_ERR_ALLOC;
+}
+
+void
+rxi_calc_batch_free (struct rxi_calc_batch *batch)
+{
+  DEBUG ("Free memory for batch");
+  free (batch->lane_data);
+  free (batch->lane_iter);
+  free (batch->thick_lines);
+  free (batch->stop_cond);
+  free (batch->col_dens);
+  free (batch->line_width);
+  free (batch->temp_bg);
+  free (batch->geom);
+  free (batch->pivot_row);
+  free (batch->lane_tmp);
+  free (batch->coll);
+  free (batch->rates);
+  free (batch->rhs);
+  free (batch->pop);
+  free (batch->prev_pop);
+  free (batch->bgfield);
+  free (batch->tau);
+  free (batch->beta);
+  free (batch->beta_geom);
+  free (batch->excit_temp);
+  free (batch);
 }
 
 char*
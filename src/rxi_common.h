@@ -10,6 +10,7 @@
 #include <stdbool.h>
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_matrix.h>
+#include <gsl/gsl_permutation.h>
 #include <gsl/gsl_const_cgsm.h>
 
 //! Program version.
@@ -29,6 +30,13 @@
 #define RXI_COLL_PARTNERS_MAX 7
 //!
 #define RXI_ELEMENTS_MAX 53
+//! Number of stored population vectors for Ng acceleration.
+#define RXI_NG_HISTORY 4
+//! Krylov subspace dimension of GMRES before a restart.
+#define RXI_GMRES_RESTART 30
+//! Lanes of `struct rxi_calc_batch` are allocated and processed in groups
+//! of this size, which covers the widest SIMD registers for doubles.
+#define RXI_BATCH_STEP 4
 
 //!
 #define RXI_FK                                                                \
@@ -80,6 +88,124 @@ enum USAGE_MODE
   UM_VERSION                  //!< Print version information.
 };
 
+/// @brief Methods to solve statistical equilibrium equations.
+typedef enum SOLVER_METHOD
+{
+  SM_FIXED_POINT = 0,     //!< Under-relaxed fixed-point iteration (RADEX).
+  SM_NEWTON               //!< Newton-Raphson on the full nonlinear system.
+}
+SOLVER_METHOD;
+
+/// @brief Solvers for linear systems of the population iteration.
+typedef enum LINEAR_SOLVER
+{
+  LS_LU = 0,              //!< Dense LU decomposition on every iteration.
+  LS_GMRES,               //!< Restarted GMRES preconditioned by an older LU.
+  LS_MIXED,               //!< Single precision LU with iterative refinement.
+  LS_LOWRANK              //!< Low-rank updates of an older LU for lines.
+}
+LINEAR_SOLVER;
+
+/// @brief Ways the last solve found populations, see `--fast-paths`.
+typedef enum FAST_PATH
+{
+  FP_NONE = 0,            //!< Iteration.
+  FP_LTE,                 //!< Boltzmann populations at the kinetic temperature.
+  FP_THIN                 //!< One solve with escape probabilities of one.
+}
+FAST_PATH;
+
+/// @brief Implementations of the LU decomposition.
+typedef enum LU_BACKEND
+{
+  LB_GSL = 0,             //!< `gsl_linalg_LU_decomp()`.
+  LB_LAPACK,              //!< `dgetrf` of system LAPACK, see `core/linalg.h`.
+  LB_BLOCKED              //!< In-house cache-blocked LU.
+}
+LU_BACKEND;
+
+/// @brief Interpolation of collisional rate coefficients between temperatures
+/// of the molecular file.
+typedef enum COLL_INTERP
+{
+  CI_LINEAR = 0,          //!< Linear, as in earlier versions.
+  CI_LOGLOG,              //!< Linear in logarithms of rates and temperatures.
+  CI_SPLINE               //!< Natural cubic spline over all temperatures.
+}
+COLL_INTERP;
+
+/// @brief Setup stages of `struct rxi_calc_data`.
+///
+/// Flags are combined into masks of stages, see `rxi_calc_data_update()`.
+/// Stages are listed in the order they run, and each one uses only results
+/// of stages before it.
+typedef enum RXI_STAGE
+{
+  RXI_STAGE_MOLECULE = 1 << 0,  //!< Levels, lines and tables of partners.
+  //! `boltz`, and collision coefficients unless rates were in the cache;
+  //! `rxi_calc_coll::temp_kin` tells which temperature they are for.
+  RXI_STAGE_TEMP_KIN = 1 << 1,
+  RXI_STAGE_DENSITIES = 1 << 2, //!< `coll_rates`, `tot_rates` and archive.
+  RXI_STAGE_TEMP_BG = 1 << 3,   //!< `bgfield`.
+  RXI_STAGE_PREPARE = 1 << 4    //!< Starting conditions of a solve.
+}
+RXI_STAGE;
+
+/// @brief Settings of the statistical equilibrium solver.
+///
+/// Zero-initialized structure gives the default RADEX-like fixed-point
+/// iteration, so every field here is an opt-in change of the solver.
+struct rxi_solver_opts
+{
+  //! Method for level populations. `--newton` option.
+  SOLVER_METHOD method;
+
+  //! Accelerate population iteration by Ng extrapolation. `--ng` option.
+  bool ng_accel;
+
+  //! Start each solve from the previous solution. `--warm-start` option.
+  bool warm_start;
+
+  //! Choose the under-relaxation weight on every iteration; not used with
+  //! `ng_accel`. `--adaptive-relax` option.
+  bool adaptive_relax;
+
+  //! Solver for linear systems. `--linear-solver` option.
+  LINEAR_SOLVER linear_solver;
+
+  //! Implementation of LU decompositions. `--lu-backend` option.
+  LU_BACKEND lu_backend;
+
+  //! Scale rows and columns of rate matrices before LU decompositions.
+  //! `--equilibrate` option.
+  bool equilibrate;
+
+  //! Solve only for levels with energies below this multiple of the largest
+  //! of kinetic and background temperatures, 0 to solve for all of them.
+  //! `--truncate` option.
+  double truncate;
+
+  //! Interpolation of collisional rate coefficients to the kinetic
+  //! temperature. `--coll-interp` option.
+  COLL_INTERP coll_interp;
+
+  //! Interpolate escape probabilities in precomputed tables, see
+  //! `core/escape_table.h`. `--escape-table` option.
+  bool escape_table;
+
+  //! Models solved at once on parameter nets, 0 to solve them one by one.
+  //! `--batch` option.
+  unsigned int batch_size;
+
+  //! Stop updating optically thin lines which converged until the next full
+  //! sweep over lines. `--freeze-lines` option.
+  bool freeze_lines;
+
+  //! Skip the iteration for models in LTE or optically thin.
+  //! `--fast-paths` option.
+  bool fast_paths;
+};
+
 /// @brief Options to set program's global state.
 ///
 /// This program acts like state machine and these options (defined through
@@ -123,6 +249,9 @@ struct rxi_options
 
   //! Path for result file (`-r` option) is written here.
   char result_path[RXI_PATH_MAX];
+
+  //! Solver settings passed to `struct rxi_input_data`.
+  struct rxi_solver_opts solver;
 };
 
 /// @brief Get `$(HOME)/.local/share/radexi/` path.
@@ -185,11 +314,19 @@ struct rxi_input_data
   double  col_dens_final;         //!< Final column density for net [cm-2].
   int     col_dens_dots;          //!< Number of dots for column density.
   double  line_width;             //!< FWHM width for all lines [km s-1].
+  double  line_width_final;       //!< Final line width for net [km s-1].
+  int     line_width_dots;        //!< Number of dots for line width.
   GEOMETRY geom;                  //!< Radiation field geometry.
   int8_t  n_coll_partners;        //!< Number of specified collision partners.
 
   COLL_PART coll_part[RXI_COLL_PARTNERS_MAX];   //!< Collision partner names.
   double coll_part_dens[RXI_COLL_PARTNERS_MAX]; //!< Partner densities [cm-3].
+  //! Final partner densities for net [cm-3].
+  double coll_part_dens_final[RXI_COLL_PARTNERS_MAX];
+  //! Number of dots for partner densities; 0 if a density is fixed.
+  int    coll_part_dens_dots[RXI_COLL_PARTNERS_MAX];
+
+  struct rxi_solver_opts solver;  //!< Statistical equilibrium solver settings.
 };
 
 /// @brief Used to read molecular information from `*.info` file or LAMDA.
@@ -317,31 +454,122 @@ struct rxi_db_molecule
   struct rxi_db_molecule_coll_part **coll_part;
 };
 
+/// @brief Constants of radiative transitions in the layout of the rate
+/// assembly loops.
+///
+/// Arrays of `numof_radtr` elements in the order of `rxi_calc_data::up`, so
+/// the solver reads them without gsl accessors or level lookups. Filled by
+/// `rxi_calc_data_fill()`.
+struct rxi_calc_lines
+{
+  size_t *up;             //!< Upper level index from zero.
+  size_t *low;            //!< Lower level index from zero.
+  double *einst;          //!< Einstein coefficient for spontaneous emission.
+  double *weight_ratio;   //!< Statistical weights ratio `g_u / g_l`.
+  double *energy;         //!< Energy difference of levels, cm^-1.
+  //! `2 h c` times cubed `energy`: background intensity divided by it is the
+  //! photon occupation number.
+  double *occ_norm;
+};
+
+/// @brief Collisional data of the partners of a model kept between setup
+/// stages.
+///
+/// Tables of partners are read from the database once per molecule by
+/// `rxi_calc_data_load_molecule()`, so a change of kinetic temperature or
+/// densities does not read files again. Models may share one, so stages
+/// check `temp_kin` of it before using `coefs` and `unit_rates`.
+struct rxi_calc_coll
+{
+  char name[RXI_MOLECULE_MAX];  //!< Molecule of the tables; empty if none.
+  int8_t numof_parts;
+  COLL_PART part[RXI_COLL_PARTNERS_MAX];
+  size_t numof_trans[RXI_COLL_PARTNERS_MAX];
+  struct rxi_db_molecule_coll_part *table[RXI_COLL_PARTNERS_MAX];
+  //! Rate coefficients of transitions of `table` interpolated to `temp_kin`.
+  double *coefs[RXI_COLL_PARTNERS_MAX];
+  //! Coefficients at the lower temperature of `bracket_lo` and
+  //! `bracket_hi` and their differences to the upper one, so `CI_LINEAR`
+  //! coefficients are blended from them for any temperature of the bracket.
+  double *bracket_base[RXI_COLL_PARTNERS_MAX];
+  double *bracket_slope[RXI_COLL_PARTNERS_MAX];
+  size_t bracket_lo[RXI_COLL_PARTNERS_MAX];  //!< `SIZE_MAX` if not filled.
+  size_t bracket_hi[RXI_COLL_PARTNERS_MAX];
+  //! Collisional rates of each partner at unit density for `temp_kin`, so
+  //! rates of any densities are their weighted sum.
+  gsl_matrix *unit_rates[RXI_COLL_PARTNERS_MAX];
+  gsl_vector *unit_tot[RXI_COLL_PARTNERS_MAX];  //!< Row sums of `unit_rates`.
+  double temp_kin;              //!< Temperature of `coefs`; NaN if none.
+  COLL_INTERP coll_interp;      //!< Interpolation of `coefs`.
+  unsigned int refs;            //!< Number of `rxi_calc_data` using it.
+};
+
+/// @brief Drops a reference to `struct rxi_calc_coll`; frees its tables and
+/// the structure itself with the last one.
+/// @param *coll -- `coll` of a `struct rxi_calc_data`.
+void rxi_calc_coll_release (struct rxi_calc_coll *coll);
+
 /// @brief Holds all information for calculation and output.
+///
+/// Level quantities (`term`, `weight`, `pop`, ...) are indexed by energy level
+/// number minus one. Line quantities (`einst`, `freq`, `bgfield`, `tau`, ...)
+/// are indexed by radiative transition in the same order as `up` and `low`,
+/// so their size scales with `numof_radtr` instead of `numof_enlev` squared.
 struct rxi_calc_data
 {
   struct rxi_input_data input;
+  //! Mask of `RXI_STAGE` flags of stages whose results are up to date with
+  //! `input`. A solve uses up starting conditions.
+  unsigned int ready;
   size_t numof_enlev;
   size_t numof_radtr;
   double chisq;
+  unsigned int numof_iter;  //!< Iterations made by the last solve.
+  //! Largest relative residual of iterative linear solves in the last solve.
+  double linear_residual;
+  //! Weight of new populations on the last iteration of the last solve; 0 if
+  //! it wasn't the under-relaxed iteration.
+  double relax;
+  //! Times Newton steps failed in the last solve and the fixed-point
+  //! iteration finished it instead.
+  unsigned int numof_fallbacks;
+  FAST_PATH fast_path;  //!< Fast path taken by the last solve, if any.
+  //! Lines updated by iterations between full sweeps with `--freeze-lines`;
+  //! the other lines keep their optical depths, escape probabilities and
+  //! excitation temperatures.
+  size_t *active;
+  size_t numof_active;
+  //! Optical depths and escape probabilities of `active` lines in their
+  //! order.
+  double *active_tau;
+  double *active_beta;
   int *up;
   int *low;
 
   gsl_vector *term;
   gsl_vector *weight;
-  gsl_matrix *einst;
-  gsl_matrix *freq;
+  gsl_vector *einst;
+  gsl_vector *freq;
   gsl_matrix *coll_rates;
   gsl_vector *tot_rates;
-  gsl_matrix *bgfield;
-
+  //! Boltzmann factors `g exp(-E / k T_kin)` of levels for detailed balance.
+  gsl_vector *boltz;
+  gsl_vector *bgfield;
+  struct rxi_calc_lines lines;
+  //! Tables of partners; models of a net of the same molecule may share
+  //! them, see `rxi_calc_data_share_molecule()`.
+  struct rxi_calc_coll *coll;
+
+  //! Rate matrix without radiative terms: collisional rates, and 1e-30 in
+  //! every element to keep it regular. Each iteration starts from a copy.
   gsl_matrix *rates_archive;
   gsl_matrix *rates;
   gsl_vector *pop;
-  gsl_matrix *tau;
-  gsl_matrix *excit_temp;
-  gsl_matrix *antenna_temp;
-  gsl_matrix *radiation_temp;
+  gsl_vector *tau;
+  gsl_vector *beta;  //!< Escape probabilities for `tau`.
+  gsl_vector *excit_temp;
+  gsl_vector *antenna_temp;
+  gsl_vector *radiation_temp;
 };
 
 /// @brief Memory allocation for `struct rxi_calc_data`.
@@ -358,6 +586,192 @@ RXI_STAT rxi_calc_data_malloc (struct rxi_calc_data **calc_data,
 /// @param *mol_cp -- pointer to a structure which needs to be freed.
 void rxi_calc_data_free (struct rxi_calc_data *calc_data);
 
+/// @brief Low-rank updates of LU factors of the rate matrix for
+/// `LS_LOWRANK`.
+///
+/// Rate matrices of iterations of a model differ only by radiative terms of
+/// lines, and the change of terms of the line from level `u` to level `l` is
+/// a rank one matrix `U V^T` with `U = e_u - e_l`. Lines whose terms changed
+/// since the factorization make the update, and systems are solved with the
+/// old factors by the Woodbury formula. Should allocate memory by
+/// `rxi_calc_lowrank_malloc()` before usage.
+struct rxi_calc_lowrank
+{
+  size_t numof_enlev;
+  size_t numof_radtr;
+  //! Largest number of lines in the update.
+  size_t max_rank;
+  //! Number of lines in the update.
+  size_t rank;
+  //! Emission and absorption terms of lines in the factorized matrix.
+  double *emission;
+  double *absorption;
+  //! Row of `z` of every line; `SIZE_MAX` if the line is not in the update.
+  size_t *row;
+  //! Line of every row of `z`.
+  size_t *line;
+  //! `A^{-1} U` for the factorized matrix `A` and lines of the update, one
+  //! line per row.
+  double *z;
+  //! Changes of emission and absorption terms of lines of the update.
+  double *d_emission;
+  double *d_absorption;
+  //! LU factors of the capacitance matrix `I + V^T A^{-1} U` of the
+  //! Woodbury formula, row-major, and their row pivots.
+  double *cap;
+  size_t *cap_perm;
+  //! Right-hand side of the capacitance system.
+  double *cap_rhs;
+  //! Numbers of systems solved with updated factors and of factorizations
+  //! of the rate matrix.
+  unsigned int numof_updates;
+  unsigned int numof_factorizations;
+};
+
+/// @brief Memory allocation for `struct rxi_calc_lowrank`.
+/// @param **lowrank -- pointer to a pointer to a structure for allocation;
+/// @param n_enlev -- number of energy levels of the molecule;
+/// @param n_radtr -- number of radiative transitions of the molecule;
+/// @param max_rank -- largest number of lines in the update.
+/// @return `RXI_OK` on success; `RXI_ERR_ALLOC` on allocation error.
+RXI_STAT rxi_calc_lowrank_malloc (struct rxi_calc_lowrank **lowrank,
+                                  const size_t n_enlev, const size_t n_radtr,
+                                  const size_t max_rank);
+
+/// @brief Free memory for `struct rxi_calc_lowrank`.
+/// @param *lowrank -- pointer to a structure which needs to be freed.
+void rxi_calc_lowrank_free (struct rxi_calc_lowrank *lowrank);
+
+/// @brief Scratch memory for the statistical equilibrium solver.
+///
+/// Holds every temporary that `rxi_calc_find_rates()` needs on each
+/// iteration, so it can be allocated once per molecule size and reused for
+/// any number of models without touching the heap. Should allocate memory by
+/// `rxi_calc_workspace_malloc()` before usage.
+struct rxi_calc_workspace
+{
+  size_t numof_enlev;
+
+  gsl_vector *b;
+  gsl_vector *x;
+  gsl_vector *prev_pop;
+  gsl_permutation *perm;
+
+  //! Last `RXI_NG_HISTORY` populations for Ng acceleration (one per row).
+  gsl_matrix *ng_hist;
+  //! Populations before Ng extrapolation to roll back to on failure.
+  gsl_vector *ng_backup;
+
+  //! Populations of the last solve to start the next one from.
+  gsl_vector *warm_pop;
+  //! Whether `warm_pop` holds a solution already.
+  bool has_warm_pop;
+
+  //! LU factors of the GMRES preconditioner or of the matrix low-rank
+  //! updates are made to.
+  gsl_matrix *precond;
+  gsl_permutation *precond_perm;
+  //! Whether `precond` holds factors already.
+  bool has_precond;
+  //! Krylov basis of GMRES, one vector per row.
+  gsl_matrix *krylov;
+  //! Hessenberg matrix of the Arnoldi process.
+  gsl_matrix *hess;
+  //! Givens rotations and right-hand side of the GMRES least squares problem.
+  gsl_vector *givens_cos;
+  gsl_vector *givens_sin;
+  gsl_vector *lsq_rhs;
+
+  //! Row and column factors of the equilibrated rate matrix.
+  gsl_vector *row_scale;
+  gsl_vector *col_scale;
+  //! Single precision LU factors of the rate matrix, row-major.
+  float *rates_float;
+  //! Residual of iterative refinement.
+  gsl_vector *resid;
+
+  //! Low-rank updates of `precond`; allocated on the first `LS_LOWRANK`
+  //! solve and kept while the number of lines stays the same.
+  struct rxi_calc_lowrank *lowrank;
+
+  //! Model and workspace for the lowest levels when levels are truncated;
+  //! allocated again whenever the number of solved levels changes, which
+  //! widening the cut does on most truncated solves.
+  struct rxi_calc_data *trunc_data;
+  struct rxi_calc_workspace *trunc_work;
+};
+
+/// @brief Memory allocation for `struct rxi_calc_workspace`.
+/// @param **work -- pointer to a pointer to a structure for allocation;
+/// @param n_enlev -- number of energy levels for current molecule (get it from
+/// database by `rxi_db_read_molecule_info()` function).
+/// @return `RXI_OK` on success; `RXI_ERR_ALLOC` on allocation error.
+RXI_STAT rxi_calc_workspace_malloc (struct rxi_calc_workspace **work,
+                                    const size_t n_enlev);
+
+/// @brief Free memory for `struct rxi_calc_workspace`.
+/// @param *work -- pointer to a structure which needs to be freed.
+void rxi_calc_workspace_free (struct rxi_calc_workspace *work);
+
+/// @brief Interleaved storage to solve several models of one molecule at once.
+///
+/// Each model occupies a lane, and quantity `i` of lane `k` is stored at
+/// `i * numof_lanes + k`. Loops over lanes go through contiguous memory, so
+/// assembly of rate matrices, LU decompositions and solves run in SIMD lanes
+/// across models. Used by `rxi_calc_find_rates_batch()`; should allocate
+/// memory by `rxi_calc_batch_malloc()` before usage.
+struct rxi_calc_batch
+{
+  size_t numof_enlev;
+  size_t numof_radtr;
+  //! Allocated lanes, a multiple of `RXI_BATCH_STEP`.
+  size_t numof_lanes;
+
+  //! Model solved in each lane.
+  struct rxi_calc_data **lane_data;
+  unsigned int *lane_iter;
+  int *thick_lines;
+  double *stop_cond;
+  double *col_dens;
+  double *line_width;
+  double *temp_bg;
+  GEOMETRY *geom;
+
+  //! Row of the largest pivot candidate in each lane.
+  size_t *pivot_row;
+  //! One value per lane for intermediate results.
+  double *lane_tmp;
+
+  //! `rates_archive` of every lane, the base of its rate matrices.
+  double *coll;
+  double *rates;
+  double *rhs;
+  double *pop;
+  double *prev_pop;
+  double *bgfield;
+  double *tau;
+  //! Escape probabilities for `tau`.
+  double *beta;
+  //! Escape probabilities of one geometry when lanes have different ones.
+  double *beta_geom;
+  double *excit_temp;
+};
+
+/// @brief Memory allocation for `struct rxi_calc_batch`.
+/// @param **batch -- pointer to a pointer to a structure for allocation;
+/// @param n_enlev -- number of energy levels of the molecule;
+/// @param n_radtr -- number of radiative transitions of the molecule;
+/// @param n_lanes -- number of models to solve at once, rounded up to a
+/// multiple of `RXI_BATCH_STEP`.
+/// @return `RXI_OK` on success; `RXI_ERR_ALLOC` on allocation error.
+RXI_STAT rxi_calc_batch_malloc (struct rxi_calc_batch **batch,
+                                const size_t n_enlev, const size_t n_radtr,
+                                const size_t n_lanes);
+
+/// @brief Free memory for `struct rxi_calc_batch`.
+/// @param *batch -- pointer to a structure which needs to be freed.
+void rxi_calc_batch_free (struct rxi_calc_batch *batch);
+
 /// @brief For output results sorting.
 struct rxi_calc_results
 {
@@ -45,7 +45,8 @@ rxi_csv_write_line (FILE *csv, const char *line)
 }
 
 RXI_STAT
-rxi_csv_read_line (FILE *csv, void **buff)
+rxi_csv_read_line (FILE *csv, void **buff, const size_t n_fields,
+                   const size_t field_size)
 {
   char *nline = malloc (RXI_STRING_MAX * sizeof (*nline));
   CHECK (nline && "Allocation failed");
@@ -58,10 +59,12 @@ rxi_csv_read_line (FILE *csv, void **buff)
       return RXI_FILE_END;
     }
 
-  int i = 0;
-  for (char *token = strtok (nline, ","); token; token = strtok (NULL, ","))
+  size_t i = 0;
+  for (char *token = strtok (nline, ",");
+       token && (i < n_fields);
+       token = strtok (NULL, ","))
     {
-      memcpy (buff[i], token, RXI_STRING_MAX);
+      snprintf (buff[i], field_size, "%s", token);
       ++i;
     }
 
@@ -7,8 +7,21 @@
 
 #include "rxi_common.h"
 
+//! Size of a field buffer of `rxi_csv_read_line()`.
+#define RXI_CSV_FIELD_MAX 256
+
 /// @brief Parse line and write it to csv (coma separated).
 RXI_STAT rxi_csv_write_line (FILE *csv, const char *line);
 
 /// @brief Read parsed line from the file to buffer.
-RXI_STAT rxi_csv_read_line (FILE *csv, void **buff);
+///
+/// Fields past @p n_fields are skipped and fields longer than @p field_size
+/// bytes with the terminating zero are cut.
+/// @param *csv -- file to read from;
+/// @param **buff -- @p n_fields buffers of @p field_size bytes each;
+/// @param n_fields -- number of buffers;
+/// @param field_size -- size of each buffer.
+/// @return `RXI_OK` on success; `RXI_FILE_END` if there are no more lines;
+/// `RXI_ERR_ALLOC` on allocation error.
+RXI_STAT rxi_csv_read_line (FILE *csv, void **buff, const size_t n_fields,
+                            const size_t field_size);
@@ -759,7 +759,7 @@ rxi_db_read_molecule_enlev (const char *name,
   char *buff[RXI_ELEMENTS_MAX];
   for (size_t i = 0; i < RXI_ELEMENTS_MAX; ++i)
     {
-      buff[i] = malloc (RXI_QNUM_MAX * sizeof (buff[i]));
+      buff[i] = malloc (RXI_CSV_FIELD_MAX * sizeof (*buff[i]));
       CHECK (buff[i] && "Allocation error");
       if (!buff[i])
         {
@@ -774,9 +774,11 @@ rxi_db_read_molecule_enlev (const char *name,
 
   int n = 0;
   RXI_STAT stat = RXI_OK;
-  for (stat = rxi_csv_read_line (enlev_csv, (void**)buff);
+  for (stat = rxi_csv_read_line (enlev_csv, (void**)buff, RXI_ELEMENTS_MAX,
+                                 RXI_CSV_FIELD_MAX);
        stat == RXI_OK;
-       stat = rxi_csv_read_line (enlev_csv, (void**)buff))
+       stat = rxi_csv_read_line (enlev_csv, (void**)buff, RXI_ELEMENTS_MAX,
+                                 RXI_CSV_FIELD_MAX))
     {
       mol_enl->level[n] = strtol (buff[0], NULL, 10);
       mol_enl->term[n] = strtod (buff[1], NULL);
@@ -830,7 +832,7 @@ rxi_db_read_molecule_radtr (const char *name,
   char *buff[RXI_ELEMENTS_MAX];
   for (size_t i = 0; i < RXI_ELEMENTS_MAX; ++i)
     {
-      buff[i] = malloc (RXI_QNUM_MAX * sizeof (buff[i]));
+      buff[i] = malloc (RXI_CSV_FIELD_MAX * sizeof (*buff[i]));
       CHECK (buff[i] && "Allocation error");
       if (!buff[i])
         {
@@ -845,9 +847,11 @@ rxi_db_read_molecule_radtr (const char *name,
 
   int n = 0;
   RXI_STAT stat;
-  for (stat = rxi_csv_read_line (radtr_csv, (void**)buff);
+  for (stat = rxi_csv_read_line (radtr_csv, (void**)buff, RXI_ELEMENTS_MAX,
+                                 RXI_CSV_FIELD_MAX);
        stat != RXI_FILE_END;
-       stat = rxi_csv_read_line (radtr_csv, (void**)buff))
+       stat = rxi_csv_read_line (radtr_csv, (void**)buff, RXI_ELEMENTS_MAX,
+                                 RXI_CSV_FIELD_MAX))
     {
       if (stat != RXI_OK)
         break;
@@ -917,7 +921,7 @@ rxi_db_read_molecule_coll_part (const char *mol_name, const COLL_PART cp,
   char *buff[RXI_ELEMENTS_MAX];
   for (size_t i = 0; i < RXI_ELEMENTS_MAX; ++i)
     {
-      buff[i] = malloc (RXI_QNUM_MAX * sizeof (buff[i]));
+      buff[i] = malloc (RXI_CSV_FIELD_MAX * sizeof (*buff[i]));
       CHECK (buff[i] && "Allocation error");
       if (!buff[i])
         {
@@ -932,9 +936,11 @@ rxi_db_read_molecule_coll_part (const char *mol_name, const COLL_PART cp,
 
   int n = 0;
   RXI_STAT stat;
-  for (stat = rxi_csv_read_line (radtr_csv, (void**)buff);
+  for (stat = rxi_csv_read_line (radtr_csv, (void**)buff, RXI_ELEMENTS_MAX,
+                                 RXI_CSV_FIELD_MAX);
        stat != RXI_FILE_END;
-       stat = rxi_csv_read_line (radtr_csv, (void**)buff))
+       stat = rxi_csv_read_line (radtr_csv, (void**)buff, RXI_ELEMENTS_MAX,
+                                 RXI_CSV_FIELD_MAX))
     {
       if (stat != RXI_OK)
         break;
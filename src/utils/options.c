@@ -2,6 +2,7 @@
  * @file options.c
  */
 
+#include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
@@ -10,6 +11,7 @@
 #include "options.h"
 
 #include "rxi_common.h"
+#include "core/linalg.h"
 #include "utils/debug.h"
 
 /// @brief Defines all possible command line options.
@@ -24,7 +26,21 @@ struct option const long_options[] = {
   {"fit",             no_argument,        NULL, 'g'},
   {"help",            no_argument,        NULL, 'h'},
   {"result",          required_argument,  NULL, 'r'},
-  {"version",         no_argument,        NULL, VERSION_OPTION}
+  {"version",         no_argument,        NULL, VERSION_OPTION},
+  {"ng",              no_argument,        NULL, NG_ACCEL_OPTION},
+  {"newton",          no_argument,        NULL, NEWTON_OPTION},
+  {"warm-start",      no_argument,        NULL, WARM_START_OPTION},
+  {"linear-solver",   required_argument,  NULL, LINEAR_SOLVER_OPTION},
+  {"lu-backend",      required_argument,  NULL, LU_BACKEND_OPTION},
+  {"batch",           required_argument,  NULL, BATCH_OPTION},
+  {"escape-table",    no_argument,        NULL, ESCAPE_TABLE_OPTION},
+  {"equilibrate",     no_argument,        NULL, EQUILIBRATE_OPTION},
+  {"adaptive-relax",  no_argument,        NULL, ADAPTIVE_RELAX_OPTION},
+  {"truncate",        required_argument,  NULL, TRUNCATE_OPTION},
+  {"coll-interp",     required_argument,  NULL, COLL_INTERP_OPTION},
+  {"freeze-lines",    no_argument,        NULL, FREEZE_LINES_OPTION},
+  {"fast-paths",      no_argument,        NULL, FAST_PATHS_OPTION},
+  {0, 0, 0, 0}
 };
 
 
@@ -43,6 +59,19 @@ rxi_set_default_options (struct rxi_options *opts)
   opts->hz_width = false;
   opts->user_defined_out_file_path = false;
   strcpy (opts->result_path, ".");
+  opts->solver.method = SM_FIXED_POINT;
+  opts->solver.ng_accel = false;
+  opts->solver.warm_start = false;
+  opts->solver.linear_solver = LS_LU;
+  opts->solver.lu_backend = LB_GSL;
+  opts->solver.batch_size = 0;
+  opts->solver.escape_table = false;
+  opts->solver.equilibrate = false;
+  opts->solver.adaptive_relax = false;
+  opts->solver.truncate = 0;
+  opts->solver.coll_interp = CI_LINEAR;
+  opts->solver.freeze_lines = false;
+  opts->solver.fast_paths = false;
 }
 
 int
@@ -140,6 +169,137 @@ rxi_set_options (struct rxi_options *opts, int argc, char **argv)
           opts->usage_mode = UM_VERSION;
           break;
 
+        case NG_ACCEL_OPTION:
+          DEBUG ("Set --ng option");
+          opts->solver.ng_accel = true;
+          break;
+
+        case NEWTON_OPTION:
+          DEBUG ("Set --newton option");
+          opts->solver.method = SM_NEWTON;
+          break;
+
+        case WARM_START_OPTION:
+          DEBUG ("Set --warm-start option");
+          opts->solver.warm_start = true;
+          break;
+
+        case ESCAPE_TABLE_OPTION:
+          DEBUG ("Set --escape-table option");
+          opts->solver.escape_table = true;
+          break;
+
+        case ADAPTIVE_RELAX_OPTION:
+          DEBUG ("Set --adaptive-relax option");
+          opts->solver.adaptive_relax = true;
+          break;
+
+        case FREEZE_LINES_OPTION:
+          DEBUG ("Set --freeze-lines option");
+          opts->solver.freeze_lines = true;
+          break;
+
+        case FAST_PATHS_OPTION:
+          DEBUG ("Set --fast-paths option");
+          opts->solver.fast_paths = true;
+          break;
+
+        case EQUILIBRATE_OPTION:
+          DEBUG ("Set --equilibrate option");
+          opts->solver.equilibrate = true;
+          break;
+
+        case LINEAR_SOLVER_OPTION:
+          DEBUG ("Set --linear-solver option");
+          if (strcmp (optarg, "lu") == 0)
+            opts->solver.linear_solver = LS_LU;
+          else if (strcmp (optarg, "gmres") == 0)
+            opts->solver.linear_solver = LS_GMRES;
+          else if (strcmp (optarg, "mixed") == 0)
+            opts->solver.linear_solver = LS_MIXED;
+          else if (strcmp (optarg, "lowrank") == 0)
+            opts->solver.linear_solver = LS_LOWRANK;
+          else
+            {
+              fprintf (stderr, "Unknown linear solver `%s'\n", optarg);
+              opts->usage_mode = UM_HELP;
+              opts->status = RXI_ERR_OPTS;
+            }
+          break;
+
+        case LU_BACKEND_OPTION:
+          DEBUG ("Set --lu-backend option");
+          if (strcmp (optarg, "gsl") == 0)
+            opts->solver.lu_backend = LB_GSL;
+          else if (strcmp (optarg, "lapack") == 0)
+            opts->solver.lu_backend = LB_LAPACK;
+          else if (strcmp (optarg, "blocked") == 0)
+            opts->solver.lu_backend = LB_BLOCKED;
+          else
+            {
+              fprintf (stderr, "Unknown LU backend `%s'\n", optarg);
+              opts->usage_mode = UM_HELP;
+              opts->status = RXI_ERR_OPTS;
+              break;
+            }
+
+          if (!rxi_linalg_has_backend (opts->solver.lu_backend))
+            {
+              fprintf (stderr, "radexi is built without `%s' LU backend\n",
+                       optarg);
+              opts->usage_mode = UM_HELP;
+              opts->status = RXI_ERR_OPTS;
+            }
+          break;
+
+        case BATCH_OPTION:
+          {
+            DEBUG ("Set --batch option");
+            char *end;
+            const long batch_size = strtol (optarg, &end, 10);
+            if (*end != '\0' || batch_size < 1 || batch_size > 4096)
+              {
+                fprintf (stderr, "Wrong batch size `%s'\n", optarg);
+                opts->usage_mode = UM_HELP;
+                opts->status = RXI_ERR_OPTS;
+                break;
+              }
+            opts->solver.batch_size = batch_size;
+          }
+          break;
+
+        case TRUNCATE_OPTION:
+          {
+            DEBUG ("Set --truncate option");
+            char *end;
+            const double truncate = strtod (optarg, &end);
+            if (*end != '\0' || !(truncate > 0))
+              {
+                fprintf (stderr, "Wrong truncation factor `%s'\n", optarg);
+                opts->usage_mode = UM_HELP;
+                opts->status = RXI_ERR_OPTS;
+                break;
+              }
+            opts->solver.truncate = truncate;
+          }
+          break;
+
+        case COLL_INTERP_OPTION:
+          DEBUG ("Set --coll-interp option");
+          if (strcmp (optarg, "linear") == 0)
+            opts->solver.coll_interp = CI_LINEAR;
+          else if (strcmp (optarg, "loglog") == 0)
+            opts->solver.coll_interp = CI_LOGLOG;
+          else if (strcmp (optarg, "spline") == 0)
+            opts->solver.coll_interp = CI_SPLINE;
+          else
+            {
+              fprintf (stderr, "Unknown interpolation `%s'\n", optarg);
+              opts->usage_mode = UM_HELP;
+              opts->status = RXI_ERR_OPTS;
+            }
+          break;
+
         case '?':
           DEBUG ("Unknown option");
           fprintf (stderr, "Unknown option was used\n");
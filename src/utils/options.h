@@ -22,7 +22,20 @@ enum
   ADD_MOLECULE_OPTION = CHAR_MAX + 1,
   LIST_MOLECULES_OPTION,
   DELETE_MOLECULE_OPTION,
-  VERSION_OPTION
+  VERSION_OPTION,
+  NG_ACCEL_OPTION,
+  NEWTON_OPTION,
+  WARM_START_OPTION,
+  LINEAR_SOLVER_OPTION,
+  LU_BACKEND_OPTION,
+  BATCH_OPTION,
+  ESCAPE_TABLE_OPTION,
+  EQUILIBRATE_OPTION,
+  ADAPTIVE_RELAX_OPTION,
+  TRUNCATE_OPTION,
+  COLL_INTERP_OPTION,
+  FREEZE_LINES_OPTION,
+  FAST_PATHS_OPTION
 };
 
 /// @brief Sets all options to their default values.
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "utils/debug.h"
+
+#include "rotor.h"
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static size_t numof_allocs = 0;
+
+void *
+malloc (size_t size)
+{
+  ++numof_allocs;
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+  ++numof_allocs;
+  return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  ++numof_allocs;
+  return __libc_realloc (ptr, size);
+}
+
+int main (void)
+{
+  const int n_enlev = 4;
+  const int n_radtr = 3;
+
+  RXI_STAT status = RXI_OK;
+  const COLL_PART part = PARA_H2;
+  const double coef = 3e-11;
+  struct rotor rotor;
+  rotor_malloc (&rotor, n_enlev, 1, &part, &coef);
+
+  struct rxi_input_data inp;
+  memset (&inp, 0, sizeof (inp));
+  strcpy (inp.name, "test");
+  inp.temp_bg = 2.73;
+  inp.line_width = 1.0;
+  inp.geom = SPHERE;
+  inp.n_coll_partners = 1;
+  inp.coll_part[0] = PARA_H2;
+
+  struct rxi_calc_data *data;
+  status = rxi_calc_data_malloc (&data, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_workspace *work;
+  status = rxi_calc_workspace_malloc (&work, n_enlev);
+  ASSERT (status == RXI_OK);
+
+  for (int model = 0; model < 4; ++model)
+    {
+      inp.temp_kin = 20 + 15 * model;
+      inp.col_dens = 1e13 * (model + 1) * 100;
+      inp.coll_part_dens[0] = 1e3 * (model + 1);
+      inp.solver.method = (model % 2) ? SM_NEWTON : SM_FIXED_POINT;
+      inp.solver.warm_start = (model >= 2);
+      inp.solver.linear_solver = (model == 3) ? LS_GMRES : LS_LU;
+      inp.solver.lu_backend = (model == 2) ? LB_BLOCKED : LB_GSL;
+
+      numof_allocs = 0;
+      data->input = inp;
+      rotor_fill (&rotor, &inp, data);
+      rxi_calc_data_set_temp_bg (data);
+      rxi_calc_find_rates (data, work, n_enlev, n_radtr);
+
+      printf ("Model %d: %zu allocations\n", model, numof_allocs);
+      if (model > 0)
+        ASSERT (numof_allocs == 0);
+    }
+
+  rxi_calc_workspace_free (work);
+  rxi_calc_data_free (data);
+  rotor_free (&rotor);
+
+  // Truncated solves allocate the model of the solved levels whenever the
+  // cut is widened, but leave the workspace as it was for other solves
+  const int n_trunc = 30;
+  rotor_malloc (&rotor, n_trunc, 1, &part, &coef);
+  status = rxi_calc_data_malloc (&data, n_trunc, n_trunc - 1);
+  ASSERT (status == RXI_OK);
+  status = rxi_calc_workspace_malloc (&work, n_trunc);
+  ASSERT (status == RXI_OK);
+
+  inp.solver = (struct rxi_solver_opts) { 0 };
+  inp.coll_part_dens[0] = 1e4;
+  inp.col_dens = 1e14;
+  for (int model = 0; model < 4; ++model)
+    {
+      inp.temp_kin = 20 + 15 * model;
+      inp.solver.truncate = (model == 1) ? 2 : 0;
+
+      numof_allocs = 0;
+      data->input = inp;
+      rotor_fill (&rotor, &inp, data);
+      rxi_calc_data_set_temp_bg (data);
+      const size_t fill_allocs = numof_allocs;
+      rxi_calc_find_rates (data, work, n_trunc, n_trunc - 1);
+      const size_t solve_allocs = numof_allocs - fill_allocs;
+
+      printf ("Truncation %g, model %d: %zu allocations\n",
+              inp.solver.truncate, model, solve_allocs);
+      if (model == 1)
+        ASSERT (solve_allocs > 0 && work->trunc_data);
+      else if (model > 1)
+        ASSERT (solve_allocs == 0);
+    }
+
+  rxi_calc_workspace_free (work);
+  rxi_calc_data_free (data);
+  rotor_free (&rotor);
+
+  return 0;
+}
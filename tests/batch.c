@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "rxi_common.h"
+#include "core/batch.h"
+#include "core/calculation.h"
+#include "utils/debug.h"
+
+#include "rotor.h"
+
+// Relative difference of `a` and `b`, 0 if both are 0
+static double
+rel_diff (const double a, const double b)
+{
+  const double scale = fmax (fabs (a), fabs (b));
+  return (scale > 0) ? fabs (a - b) / scale : 0;
+}
+
+int main (void)
+{
+  const int n_enlev = 5;
+  const int n_radtr = 4;
+  // More models than lanes, so converged lanes get refilled and compacted
+  const int n_models = 11;
+
+  RXI_STAT status = RXI_OK;
+  const COLL_PART part = PARA_H2;
+  const double coef = 3e-11;
+  struct rotor rotor;
+  rotor_malloc (&rotor, n_enlev, 1, &part, &coef);
+
+  struct rxi_input_data inp;
+  memset (&inp, 0, sizeof (inp));
+  strcpy (inp.name, "test");
+  inp.temp_bg = 2.73;
+  inp.line_width = 1.0;
+  inp.n_coll_partners = 1;
+  inp.coll_part[0] = PARA_H2;
+
+  struct rxi_calc_data *scalar[n_models];
+  struct rxi_calc_data *batched[n_models];
+  struct rxi_calc_workspace *work;
+  status = rxi_calc_workspace_malloc (&work, n_enlev);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_batch *batch;
+  status = rxi_calc_batch_malloc (&batch, n_enlev, n_radtr, 3);
+  ASSERT (status == RXI_OK);
+  ASSERT (batch->numof_lanes == RXI_BATCH_STEP);
+
+  for (int m = 0; m < n_models; ++m)
+    {
+      // Optically thin and thick models converge after different numbers of
+      // iterations
+      inp.temp_kin = 20 + 7 * m;
+      inp.col_dens = 1e12 * (1 << m);
+      inp.coll_part_dens[0] = 1e2 * (m + 1);
+      inp.geom = SPHERE + m % 3;
+
+      status = rxi_calc_data_malloc (&scalar[m], n_enlev, n_radtr);
+      ASSERT (status == RXI_OK);
+      status = rxi_calc_data_malloc (&batched[m], n_enlev, n_radtr);
+      ASSERT (status == RXI_OK);
+
+      scalar[m]->input = inp;
+      rotor_fill (&rotor, &inp, scalar[m]);
+      rxi_calc_data_set_temp_bg (scalar[m]);
+      batched[m]->input = inp;
+      rotor_fill (&rotor, &inp, batched[m]);
+      rxi_calc_data_set_temp_bg (batched[m]);
+
+      rxi_calc_find_rates (scalar[m], work, n_enlev, n_radtr);
+    }
+
+  status = rxi_calc_find_rates_batch (batched, n_models, batch);
+  ASSERT (status == RXI_OK);
+
+  // Same iteration, but batched lanes have their own LU decomposition, which
+  // may round differently from the one of GSL, so the iteration may stop a
+  // step apart
+  for (int m = 0; m < n_models; ++m)
+    {
+      double diff_max = 0;
+      for (int i = 0; i < n_enlev; ++i)
+        diff_max = fmax (diff_max,
+                         rel_diff (gsl_vector_get (scalar[m]->pop, i),
+                                   gsl_vector_get (batched[m]->pop, i)));
+      for (int i = 0; i < n_radtr; ++i)
+        {
+          diff_max = fmax (diff_max,
+                           rel_diff (gsl_vector_get (scalar[m]->tau, i),
+                                     gsl_vector_get (batched[m]->tau, i)));
+          diff_max = fmax (diff_max, rel_diff (
+              gsl_vector_get (scalar[m]->excit_temp, i),
+              gsl_vector_get (batched[m]->excit_temp, i)));
+        }
+
+      printf ("Model %d: %u and %u iterations, results %.3e\n", m,
+              scalar[m]->numof_iter, batched[m]->numof_iter, diff_max);
+      ASSERT (abs ((int) scalar[m]->numof_iter
+                   - (int) batched[m]->numof_iter) <= 1);
+      ASSERT (diff_max < 1e-5);
+
+      rxi_calc_data_free (scalar[m]);
+      rxi_calc_data_free (batched[m]);
+    }
+
+  rxi_calc_batch_free (batch);
+  rxi_calc_workspace_free (work);
+  rotor_free (&rotor);
+
+  return 0;
+}
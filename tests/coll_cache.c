@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "core/coll_cache.h"
+#include "utils/debug.h"
+
+#include "rotor.h"
+
+static bool
+same_rates (const struct rxi_calc_data *a, const struct rxi_calc_data *b)
+{
+  for (size_t i = 0; i < a->coll_rates->size1; ++i)
+    {
+      if (gsl_vector_get (a->tot_rates, i) != gsl_vector_get (b->tot_rates, i))
+        return false;
+      for (size_t j = 0; j < a->coll_rates->size2; ++j)
+        if (gsl_matrix_get (a->coll_rates, i, j)
+            != gsl_matrix_get (b->coll_rates, i, j))
+          return false;
+    }
+
+  return true;
+}
+
+int main (void)
+{
+  const int n_enlev = 5;
+  const int n_radtr = n_enlev - 1;
+
+  RXI_STAT status = RXI_OK;
+  const COLL_PART part = PARA_H2;
+  const double coef = 3e-11;
+  struct rotor rotor;
+  rotor_malloc (&rotor, n_enlev, 1, &part, &coef);
+
+  struct rxi_input_data inp;
+  memset (&inp, 0, sizeof (inp));
+  strcpy (inp.name, "test");
+  inp.temp_kin = 20;
+  inp.col_dens = 1e14;
+  inp.line_width = 1.0;
+  inp.n_coll_partners = 1;
+  inp.coll_part[0] = PARA_H2;
+  inp.coll_part_dens[0] = 1e4;
+
+  struct rxi_calc_data *filled;
+  status = rxi_calc_data_malloc (&filled, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_data *cached;
+  status = rxi_calc_data_malloc (&cached, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+
+  bool hit;
+  size_t hits, misses;
+  rotor_fill (&rotor, &inp, filled);
+  hit = rxi_coll_cache_get (&inp, cached);
+  ASSERT (!hit);
+  status = rxi_coll_cache_put (&inp, filled);
+  ASSERT (status == RXI_OK);
+
+  // Column density and line width do not change collisional rates
+  inp.col_dens = 1e17;
+  inp.line_width = 3.0;
+  hit = rxi_coll_cache_get (&inp, cached);
+  ASSERT (hit);
+  ASSERT (same_rates (filled, cached));
+
+  // Everything else does
+  inp.temp_kin = 21;
+  hit = rxi_coll_cache_get (&inp, cached);
+  ASSERT (!hit);
+  inp.temp_kin = 20;
+  inp.coll_part_dens[0] = 2e4;
+  hit = rxi_coll_cache_get (&inp, cached);
+  ASSERT (!hit);
+  inp.coll_part_dens[0] = 1e4;
+  inp.solver.coll_interp = CI_SPLINE;
+  hit = rxi_coll_cache_get (&inp, cached);
+  ASSERT (!hit);
+  inp.solver.coll_interp = CI_LINEAR;
+  strcpy (inp.name, "other");
+  hit = rxi_coll_cache_get (&inp, cached);
+  ASSERT (!hit);
+  strcpy (inp.name, "test");
+
+  rxi_coll_cache_stats (&hits, &misses);
+  printf ("hits: %zu, misses: %zu\n", hits, misses);
+  ASSERT (hits == 1 && misses == 5);
+
+  // The model at 20 K is used last, so other temperatures are evicted first
+  for (int i = 1; i < RXI_COLL_CACHE_SIZE; ++i)
+    {
+      inp.temp_kin = 20 + i;
+      rotor_fill (&rotor, &inp, filled);
+      status = rxi_coll_cache_put (&inp, filled);
+      ASSERT (status == RXI_OK);
+    }
+  inp.temp_kin = 20;
+  hit = rxi_coll_cache_get (&inp, cached);
+  ASSERT (hit);
+  inp.temp_kin = 100;
+  rotor_fill (&rotor, &inp, filled);
+  status = rxi_coll_cache_put (&inp, filled);
+  ASSERT (status == RXI_OK);
+
+  inp.temp_kin = 21;
+  hit = rxi_coll_cache_get (&inp, cached);
+  ASSERT (!hit);
+  inp.temp_kin = 100;
+  hit = rxi_coll_cache_get (&inp, cached);
+  ASSERT (hit);
+  ASSERT (same_rates (filled, cached));
+  for (int i = 2; i < RXI_COLL_CACHE_SIZE; ++i)
+    {
+      inp.temp_kin = 20 + i;
+      hit = rxi_coll_cache_get (&inp, cached);
+      ASSERT (hit);
+    }
+
+  rxi_coll_cache_clear ();
+  rxi_coll_cache_stats (&hits, &misses);
+  ASSERT (hits == 0 && misses == 0);
+  inp.temp_kin = 100;
+  hit = rxi_coll_cache_get (&inp, cached);
+  ASSERT (!hit);
+
+  rxi_calc_data_free (filled);
+  rxi_calc_data_free (cached);
+  rotor_free (&rotor);
+
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "rxi_common.h"
+#include "core/coll_interp.h"
+#include "utils/debug.h"
+
+// Interpolation of earlier versions, one transition at a time
+static double
+reference_linear (const double kin_temp, const double *temps,
+                  const double *rates, const size_t n_temps)
+{
+  for (size_t i = 0; i < n_temps; ++i)
+    {
+      if (kin_temp > temps[i])
+        continue;
+      if (i == n_temps - 1)
+        return rates[i];
+      return rates[i] + (rates[i + 1] - rates[i]) * (kin_temp - temps[i])
+                        / (temps[i + 1] - temps[i]);
+    }
+
+  return rates[n_temps - 1];
+}
+
+static double
+rel_diff (const double a, const double b)
+{
+  return fabs (a - b) / fmax (fabs (b), 1e-300);
+}
+
+int
+main (void)
+{
+  const double temps[] = { 10, 20, 30, 50, 100, 200, 500 };
+  const size_t n_temps = sizeof (temps) / sizeof (temps[0]);
+  enum { POWER, LINEAR, ZERO, N_TRANS };
+
+  // Rows padded to check the distance between rows
+  const size_t tda = n_temps + 3;
+  double rates[N_TRANS * (n_temps + 3)];
+  for (size_t t = 0; t < n_temps; ++t)
+    {
+      rates[POWER * tda + t] = 2e-11 * pow (temps[t], 0.7);
+      rates[LINEAR * tda + t] = 1e-11 + 3e-13 * temps[t];
+      rates[ZERO * tda + t] = (t < 3) ? 0 : 1e-12 * t;
+    }
+
+  double coefs[N_TRANS];
+  double base[N_TRANS];
+  double slope[N_TRANS];
+  double blended[N_TRANS];
+  size_t bracket_lo = SIZE_MAX;
+  size_t n_brackets = 0;
+  struct rxi_coll_interp interp;
+  double diff_linear = 0;
+  double diff_loglog = 0;
+  double diff_spline = 0;
+  for (double temp = 2; temp < 1000; temp *= 1.01)
+    {
+      rxi_coll_interp_init (&interp, CI_LINEAR, temps, n_temps, temp);
+      rxi_coll_interp_rates (&interp, N_TRANS, rates, tda, coefs);
+      for (int k = 0; k < N_TRANS; ++k)
+        {
+          const double ref = reference_linear (temp, temps, rates + k * tda,
+                                               n_temps);
+          diff_linear = fmax (diff_linear, fabs (coefs[k] - ref)
+                                           / fmax (fabs (ref), 1e-12));
+        }
+
+      // Blends of a bracket read once are the same as interpolation
+      if (interp.lo != bracket_lo)
+        {
+          rxi_coll_interp_bracket (&interp, N_TRANS, rates, tda, base, slope);
+          bracket_lo = interp.lo;
+          ++n_brackets;
+        }
+      rxi_coll_interp_blend (&interp, N_TRANS, base, slope, blended);
+      for (int k = 0; k < N_TRANS; ++k)
+        ASSERT (blended[k] == coefs[k]);
+
+      // Power laws are exact for log-log interpolation, linear functions
+      // for splines; both keep the coefficients of the ends outside
+      const double clamped = fmin (fmax (temp, temps[0]), temps[n_temps - 1]);
+      rxi_coll_interp_init (&interp, CI_LOGLOG, temps, n_temps, temp);
+      rxi_coll_interp_rates (&interp, N_TRANS, rates, tda, coefs);
+      diff_loglog = fmax (diff_loglog,
+                          rel_diff (coefs[POWER], 2e-11 * pow (clamped, 0.7)));
+
+      rxi_coll_interp_init (&interp, CI_SPLINE, temps, n_temps, temp);
+      rxi_coll_interp_rates (&interp, N_TRANS, rates, tda, coefs);
+      diff_spline = fmax (diff_spline,
+                          rel_diff (coefs[LINEAR], 1e-11 + 3e-13 * clamped));
+      ASSERT (coefs[ZERO] >= 0);
+    }
+
+  // All methods go through the coefficients of the file
+  for (size_t t = 0; t < n_temps; ++t)
+    {
+      const COLL_INTERP methods[] = { CI_LINEAR, CI_LOGLOG, CI_SPLINE };
+      for (size_t m = 0; m < sizeof (methods) / sizeof (methods[0]); ++m)
+        {
+          rxi_coll_interp_init (&interp, methods[m], temps, n_temps,
+                                temps[t]);
+          rxi_coll_interp_rates (&interp, N_TRANS, rates, tda, coefs);
+          for (int k = 0; k < N_TRANS; ++k)
+            ASSERT (rel_diff (coefs[k], rates[k * tda + t]) < 1e-14
+                    || fabs (coefs[k] - rates[k * tda + t]) < 1e-26);
+        }
+    }
+
+  printf ("linear: %.3e, log-log: %.3e, spline: %.3e\n", diff_linear,
+          diff_loglog, diff_spline);
+  ASSERT (n_brackets == n_temps);
+  ASSERT (diff_linear < 1e-14);
+  ASSERT (diff_loglog < 1e-13);
+  ASSERT (diff_spline < 1e-13);
+
+  exit (EXIT_SUCCESS);
+}
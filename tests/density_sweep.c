@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "core/coll_cache.h"
+#include "utils/debug.h"
+
+#include "rotor.h"
+
+// Largest difference of collisional rates of `a` and `b` relative to the
+// largest rate of a row
+static double
+rates_diff (const struct rxi_calc_data *a, const struct rxi_calc_data *b)
+{
+  double diff = 0;
+  for (size_t i = 0; i < a->coll_rates->size1; ++i)
+    {
+      const double tot = gsl_vector_get (a->tot_rates, i);
+      diff = fmax (diff, fabs (tot - gsl_vector_get (b->tot_rates, i)) / tot);
+      for (size_t j = 0; j < a->coll_rates->size2; ++j)
+        diff = fmax (diff, fabs (gsl_matrix_get (a->coll_rates, i, j)
+                                 - gsl_matrix_get (b->coll_rates, i, j))
+                           / tot);
+    }
+
+  return diff;
+}
+
+int main (void)
+{
+  const int n_enlev = 6;
+  const int n_radtr = n_enlev - 1;
+  const COLL_PART parts[] = { PARA_H2, ELECTRONS };
+  const int n_parts = sizeof (parts) / sizeof (parts[0]);
+
+  RXI_STAT status = RXI_OK;
+  // Electrons are much more efficient than molecular hydrogen
+  const double coefs[] = { 3e-11, 2e-6 };
+  struct rotor rotor;
+  rotor_malloc (&rotor, n_enlev, n_parts, parts, coefs);
+
+  struct rxi_input_data inp;
+  memset (&inp, 0, sizeof (inp));
+  strcpy (inp.name, "test");
+  inp.temp_kin = 30;
+  inp.temp_bg = 2.73;
+  inp.col_dens = 1e14;
+  inp.line_width = 1.0;
+  inp.n_coll_partners = n_parts;
+  for (int p = 0; p < n_parts; ++p)
+    inp.coll_part[p] = parts[p];
+
+  struct rxi_calc_data *filled;
+  status = rxi_calc_data_malloc (&filled, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_data *swept;
+  status = rxi_calc_data_malloc (&swept, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+
+  // Tables are loaded from memory as `rxi_calc_data_load_molecule()` reads
+  // them from the database
+  swept->input = inp;
+  status = rxi_calc_data_load_tables (swept, rotor.info, rotor.enlev,
+                                      rotor.radtr, rotor.cp);
+  ASSERT (status == RXI_OK);
+  ASSERT (swept->ready == RXI_STAGE_MOLECULE);
+  rxi_calc_data_set_temp_kin (swept, rotor.info);
+
+  // Only densities change, so rates are sums of the same unit density rates
+  const double h2_dens[] = { 1e2, 3e4, 1e7 };
+  const double e_dens[] = { 0, 1, 50 };
+  double diff_max = 0;
+  for (size_t i = 0; i < sizeof (h2_dens) / sizeof (h2_dens[0]); ++i)
+    {
+      for (size_t j = 0; j < sizeof (e_dens) / sizeof (e_dens[0]); ++j)
+        {
+          inp.coll_part_dens[0] = h2_dens[i];
+          inp.coll_part_dens[1] = e_dens[j];
+          rotor_fill (&rotor, &inp, filled);
+          swept->input = inp;
+          rxi_calc_data_set_densities (swept);
+          diff_max = fmax (diff_max, rates_diff (filled, swept));
+        }
+    }
+
+  printf ("rates: %.3e\n", diff_max);
+  ASSERT (diff_max < 1e-14);
+
+  // Updates redo only the stages whose inputs changed, so results of the
+  // others keep the marks put on them
+  const unsigned int all = RXI_STAGE_MOLECULE | RXI_STAGE_TEMP_KIN
+                           | RXI_STAGE_DENSITIES | RXI_STAGE_TEMP_BG
+                           | RXI_STAGE_PREPARE;
+  status = rxi_calc_data_update (swept, &inp, rotor.info);
+  ASSERT (status == RXI_OK);
+  ASSERT (swept->ready == all);
+
+  gsl_vector_set (swept->tot_rates, 0, -1);
+  gsl_vector_set (swept->bgfield, 0, -1);
+  inp.col_dens = 1e16;
+  inp.line_width = 2.0;
+  rxi_calc_data_update (swept, &inp, rotor.info);
+  ASSERT (gsl_vector_get (swept->tot_rates, 0) == -1);
+  ASSERT (gsl_vector_get (swept->bgfield, 0) == -1);
+
+  inp.temp_bg = 10;
+  rxi_calc_data_update (swept, &inp, rotor.info);
+  ASSERT (gsl_vector_get (swept->tot_rates, 0) == -1);
+  ASSERT (gsl_vector_get (swept->bgfield, 0) > 0);
+
+  inp.coll_part_dens[0] = 5e5;
+  rxi_calc_data_update (swept, &inp, rotor.info);
+  rotor_fill (&rotor, &inp, filled);
+  ASSERT (rates_diff (filled, swept) < 1e-14);
+  ASSERT (swept->ready == all);
+
+  // A new temperature makes rates out of date
+  inp.temp_kin = 60;
+  rxi_calc_data_update (swept, &inp, rotor.info);
+  rotor_fill (&rotor, &inp, filled);
+  ASSERT (rates_diff (filled, swept) < 1e-14);
+
+  // Rates found in the cache are not interpolated, so the next change of
+  // the temperature alone, and then of densities alone, interpolates again
+  struct rxi_calc_data *cached;
+  status = rxi_calc_data_malloc (&cached, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+  cached->input = inp;
+  status = rxi_calc_data_load_tables (cached, rotor.info, rotor.enlev,
+                                      rotor.radtr, rotor.cp);
+  ASSERT (status == RXI_OK);
+  size_t hits, misses;
+  rxi_coll_cache_stats (&hits, &misses);
+  const size_t hits_before = hits;
+  rxi_calc_data_update (cached, &inp, rotor.info);
+  rxi_coll_cache_stats (&hits, &misses);
+  ASSERT (hits == hits_before + 1);
+  ASSERT (cached->ready == all);
+
+  const double steps[][2] = { { 45, 5e5 }, { 60, 5e5 }, { 60, 2e3 } };
+  for (size_t i = 0; i < sizeof (steps) / sizeof (steps[0]); ++i)
+    {
+      inp.temp_kin = steps[i][0];
+      inp.coll_part_dens[0] = steps[i][1];
+      rxi_calc_data_update (cached, &inp, rotor.info);
+      rotor_fill (&rotor, &inp, filled);
+      ASSERT (rates_diff (filled, cached) < 1e-14);
+      ASSERT (cached->ready == all);
+    }
+  rxi_coll_cache_stats (&hits, &misses);
+  ASSERT (hits == hits_before + 2);
+
+  // Models sharing tables interpolate them to their own temperatures, and
+  // keep the rates summed before
+  struct rxi_calc_data *shared;
+  status = rxi_calc_data_malloc (&shared, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+  rxi_calc_data_share_molecule (shared, cached);
+  ASSERT (shared->coll == cached->coll && cached->coll->refs == 2);
+  ASSERT (shared->ready == RXI_STAGE_MOLECULE);
+
+  inp.temp_kin = 25;
+  inp.coll_part_dens[0] = 7e3;
+  rxi_calc_data_update (shared, &inp, rotor.info);
+  rotor_fill (&rotor, &inp, filled);
+  ASSERT (rates_diff (filled, shared) < 1e-14);
+  ASSERT (rates_diff (filled, cached) > 1e-3);
+
+  inp.temp_kin = 80;
+  inp.coll_part_dens[0] = 9e3;
+  rxi_calc_data_update (cached, &inp, rotor.info);
+  rotor_fill (&rotor, &inp, filled);
+  ASSERT (rates_diff (filled, cached) < 1e-14);
+
+  rxi_calc_data_free (shared);
+  ASSERT (cached->coll->refs == 1);
+  rxi_calc_data_free (cached);
+  rxi_calc_data_free (filled);
+  rxi_calc_data_free (swept);
+  rotor_free (&rotor);
+
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "utils/debug.h"
+
+int main (void)
+{
+  // Upper levels are far enough above the kinetic temperatures below for
+  // their Boltzmann factors to underflow
+  const double terms[] = { 0, 2.5, 7.5, 3000, 3004, 3010 };
+  const int n_enlev = sizeof (terms) / sizeof (terms[0]);
+  const int n_radtr = n_enlev - 1;
+  const int n_trans = n_enlev * (n_enlev - 1) / 2;
+  const int n_temps = 2;
+
+  RXI_STAT status = RXI_OK;
+  struct rxi_db_molecule_info *info;
+  status = rxi_db_molecule_info_malloc (&info);
+  ASSERT (status == RXI_OK);
+  info->numof_enlev = n_enlev;
+  info->numof_radtr = n_radtr;
+  info->numof_coll_part = 1;
+  info->coll_part[0] = PARA_H2;
+  info->numof_coll_trans[0] = n_trans;
+  info->numof_coll_temps[0] = n_temps;
+  gsl_matrix_set (info->coll_temps, 0, 0, 10);
+  gsl_matrix_set (info->coll_temps, 0, 1, 100);
+
+  struct rxi_db_molecule_enlev *enlev;
+  status = rxi_db_molecule_enlev_malloc (&enlev, n_enlev);
+  ASSERT (status == RXI_OK);
+  for (int i = 0; i < n_enlev; ++i)
+    {
+      enlev->level[i] = i + 1;
+      enlev->term[i] = terms[i];
+      enlev->weight[i] = 2 * i + 1;
+    }
+
+  struct rxi_db_molecule_radtr *radtr;
+  status = rxi_db_molecule_radtr_malloc (&radtr, n_radtr);
+  ASSERT (status == RXI_OK);
+  for (int i = 0; i < n_radtr; ++i)
+    {
+      radtr->up[i] = i + 2;
+      radtr->low[i] = i + 1;
+      radtr->einst[i] = 1e-6;
+      radtr->freq[i] = 100;
+    }
+
+  // Every pair of levels has collisional data; the last one is listed from
+  // the lower level
+  struct rxi_db_molecule_coll_part *cp;
+  status = rxi_db_molecule_coll_part_malloc (&cp, n_trans, n_temps);
+  ASSERT (status == RXI_OK);
+  int k = 0;
+  for (int u = 2; u <= n_enlev; ++u)
+    {
+      for (int l = 1; l < u; ++l)
+        {
+          cp->up[k] = u;
+          cp->low[k] = l;
+          // Same at all temperatures to leave interpolation out
+          gsl_matrix_set (cp->coll_rates, k, 0, 1e-11 * u / l);
+          gsl_matrix_set (cp->coll_rates, k, 1, 1e-11 * u / l);
+          ++k;
+        }
+    }
+  cp->up[n_trans - 1] = n_enlev - 1;
+  cp->low[n_trans - 1] = n_enlev;
+
+  struct rxi_input_data inp;
+  memset (&inp, 0, sizeof (inp));
+  strcpy (inp.name, "test");
+  inp.temp_bg = 2.73;
+  inp.col_dens = 1e14;
+  inp.line_width = 1.0;
+  inp.n_coll_partners = 1;
+  inp.coll_part[0] = PARA_H2;
+  inp.coll_part_dens[0] = 1e4;
+
+  struct rxi_calc_data *data;
+  status = rxi_calc_data_malloc (&data, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+
+  const double temps[] = { 3, 20, 80 };
+  double diff_max = 0;
+  double tot_diff_max = 0;
+  for (size_t t = 0; t < sizeof (temps) / sizeof (temps[0]); ++t)
+    {
+      inp.temp_kin = temps[t];
+      data->input = inp;
+      rxi_calc_data_fill (&inp, info, enlev, radtr, &cp, data);
+
+      for (int i = 0; i < n_enlev; ++i)
+        {
+          double tot = 0;
+          for (int j = 0; j < n_enlev; ++j)
+            {
+              const double rate = gsl_matrix_get (data->coll_rates, i, j);
+              tot += rate;
+              if (j >= i)
+                continue;
+
+              // Downward rates are the coefficients, upward ones their
+              // detailed balance
+              const double down = 1e4 * 1e-11 * (i + 1) / (j + 1);
+              ASSERT (fabs (rate - down) < 1e-12 * down);
+              const double up = rxi_calc_crate (2 * i + 1, 2 * j + 1,
+                                                terms[i] - terms[j],
+                                                temps[t], down);
+              const double diff = fabs (gsl_matrix_get (data->coll_rates,
+                                                        j, i) - up);
+              if (up > 0)
+                diff_max = fmax (diff_max, diff / up);
+              else
+                ASSERT (diff == 0);
+            }
+          tot_diff_max = fmax (tot_diff_max,
+              fabs (gsl_vector_get (data->tot_rates, i) - tot) / tot);
+        }
+    }
+
+  printf ("upward rates: %.3e, totals: %.3e\n", diff_max, tot_diff_max);
+  ASSERT (diff_max < 1e-12);
+  ASSERT (tot_diff_max < 1e-14);
+
+  rxi_calc_data_free (data);
+  rxi_db_molecule_coll_part_free (cp);
+  rxi_db_molecule_radtr_free (radtr);
+  rxi_db_molecule_enlev_free (enlev);
+  rxi_db_molecule_info_free (info);
+
+  exit (EXIT_SUCCESS);
+}
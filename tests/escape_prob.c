@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "utils/debug.h"
+
+int
+main (void)
+{
+  const GEOMETRY geoms[] = { SPHERE, SLAB, LVG };
+  const double taus[] = { -3, -0.5, 1e-3, 0.01, 0.05, 0.15, 0.5, 1, 3, 10,
+                          13, 30, 80, 120, 1e3 };
+
+  for (size_t g = 0; g < sizeof (geoms) / sizeof (geoms[0]); ++g)
+    {
+      for (size_t i = 0; i < sizeof (taus) / sizeof (taus[0]); ++i)
+        {
+          const double tau = taus[i];
+          const double h = 1e-6 * fabs (tau);
+          const double numeric =
+                  (rxi_calc_escape_prob (tau + h, geoms[g])
+                   - rxi_calc_escape_prob (tau - h, geoms[g]))
+              / //---------------------------------------------
+                                    (2 * h);
+          const double analytic = rxi_calc_escape_prob_deriv (tau, geoms[g]);
+
+          printf ("geom %d, tau %9.3e: %12.5e %12.5e\n", geoms[g], tau,
+                  analytic, numeric);
+          ASSERT (fabs (analytic - numeric) <= 1e-5 * fabs (numeric) + 1e-12);
+        }
+    }
+
+  // Series and exact slab expressions have to match at the switch point
+  const double tau_switch = 0.1 / 3;
+  ASSERT (fabs (rxi_calc_escape_prob (tau_switch * (1 - 1e-9), SLAB)
+                - rxi_calc_escape_prob (tau_switch * (1 + 1e-9), SLAB))
+          < 1e-6);
+
+  // Array versions against scalar ones on all branches and around switches;
+  // the length is not a multiple of a kernel chunk
+  const size_t n = 403;
+  double tau[n];
+  double beta[n];
+  for (size_t i = 0; i < n; ++i)
+    tau[i] = ((i % 2) ? 1 : -1e-3) * pow (10, -4 + 8.0 * i / n);
+  tau[0] = 0.02;
+  tau[1] = 0.2;
+  tau[2] = 14;
+  tau[3] = 100;
+  tau[4] = tau_switch;
+
+  for (size_t g = 0; g < sizeof (geoms) / sizeof (geoms[0]); ++g)
+    {
+      rxi_calc_escape_prob_array (geoms[g], n, tau, beta);
+      double diff_max = 0;
+      for (size_t i = 0; i < n; ++i)
+        {
+          const double scalar = rxi_calc_escape_prob (tau[i], geoms[g]);
+          diff_max = fmax (diff_max, fabs (beta[i] - scalar) / fabs (scalar));
+        }
+      printf ("geom %d, array version: relative difference %.3e\n",
+              geoms[g], diff_max);
+      ASSERT (diff_max < 1e-12);
+    }
+
+  exit (EXIT_SUCCESS);
+}
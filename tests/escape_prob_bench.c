@@ -0,0 +1,76 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "core/escape_table.h"
+#include "utils/debug.h"
+
+// Microbenchmark of scalar, array and tabulated escape probabilities
+
+static double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+int
+main (void)
+{
+  const GEOMETRY geoms[] = { SPHERE, SLAB, LVG };
+  const size_t n = 1000;
+  const int repeats = 2000;
+
+  double *tau = malloc (n * sizeof (*tau));
+  double *beta = malloc (n * sizeof (*beta));
+  ASSERT (tau && beta);
+
+  // Optical depths of real models span all branches in no particular order
+  srand (1);
+  for (size_t i = 0; i < n; ++i)
+    tau[i] = pow (10, -4 + 7 * (rand () / (double) RAND_MAX));
+
+  double sum = 0;
+  for (size_t g = 0; g < sizeof (geoms) / sizeof (geoms[0]); ++g)
+    {
+      double start = now ();
+      for (int r = 0; r < repeats; ++r)
+        {
+          for (size_t i = 0; i < n; ++i)
+            beta[i] = rxi_calc_escape_prob (tau[i], geoms[g]);
+          sum += beta[r % n];
+        }
+      const double scalar = (now () - start) / repeats / n;
+
+      start = now ();
+      for (int r = 0; r < repeats; ++r)
+        {
+          rxi_calc_escape_prob_array (geoms[g], n, tau, beta);
+          sum += beta[r % n];
+        }
+      const double array = (now () - start) / repeats / n;
+
+      start = now ();
+      for (int r = 0; r < repeats; ++r)
+        {
+          rxi_calc_escape_prob_table (geoms[g], n, tau, beta);
+          sum += beta[r % n];
+        }
+      const double table = (now () - start) / repeats / n;
+
+      printf ("escape probability, geom %d: scalar %.2f ns, array %.2f ns, "
+              "table %.2f ns\n", geoms[g], 1e9 * scalar, 1e9 * array,
+              1e9 * table);
+    }
+
+  printf ("checksum %e\n", sum);
+
+  free (tau);
+  free (beta);
+
+  exit (EXIT_SUCCESS);
+}
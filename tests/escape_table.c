@@ -0,0 +1,55 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "core/escape_table.h"
+#include "utils/debug.h"
+
+int
+main (void)
+{
+  const GEOMETRY geoms[] = { SPHERE, SLAB, LVG };
+
+  // Dense sweep over all branches, both signs, edges of the tables and
+  // switch points of `rxi_calc_escape_prob()`
+  const size_t n_sweep = 200000;
+  const double edges[] = { 0x1p-6, 0x1p-5, 0x1p-3, 0x1p4, 0x1p5, 0x1p7,
+                           0x1p24, 0.02, 0.2, 0.1 / 3, 50 / 3.0, 14, 100,
+                           0, -0.5, -3, -1e3, 1e12 };
+  const size_t n_edges = sizeof (edges) / sizeof (edges[0]);
+  const size_t n = n_sweep + 3 * n_edges;
+
+  double *tau = malloc (n * sizeof (double));
+  double *beta = malloc (n * sizeof (double));
+  ASSERT (tau && beta);
+
+  for (size_t i = 0; i < n_sweep; ++i)
+    tau[i] = pow (10, -5 + 14.0 * i / n_sweep);
+  for (size_t i = 0; i < n_edges; ++i)
+    {
+      tau[n_sweep + 3 * i] = edges[i];
+      tau[n_sweep + 3 * i + 1] = nextafter (edges[i], -INFINITY);
+      tau[n_sweep + 3 * i + 2] = nextafter (edges[i], INFINITY);
+    }
+
+  for (size_t g = 0; g < sizeof (geoms) / sizeof (geoms[0]); ++g)
+    {
+      rxi_calc_escape_prob_table (geoms[g], n, tau, beta);
+      double diff_max = 0;
+      for (size_t i = 0; i < n; ++i)
+        {
+          const double exact = rxi_calc_escape_prob (tau[i], geoms[g]);
+          diff_max = fmax (diff_max, fabs (beta[i] - exact) / fabs (exact));
+        }
+      printf ("geom %d, table: relative difference %.3e\n", geoms[g],
+              diff_max);
+      ASSERT (diff_max < RXI_ESCAPE_TABLE_ERROR);
+    }
+
+  free (tau);
+  free (beta);
+
+  exit (EXIT_SUCCESS);
+}
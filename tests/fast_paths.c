@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "utils/debug.h"
+
+#include "rotor.h"
+
+int main (void)
+{
+  const int n_enlev = 30;
+  const int n_radtr = n_enlev - 1;
+
+  RXI_STAT status = RXI_OK;
+  const COLL_PART part = PARA_H2;
+  const double coef = 3e-11;
+  struct rotor rotor;
+  rotor_malloc (&rotor, n_enlev, 1, &part, &coef);
+
+  struct rxi_input_data inp;
+  memset (&inp, 0, sizeof (inp));
+  strcpy (inp.name, "test");
+  inp.temp_bg = 2.73;
+  inp.line_width = 1.0;
+  inp.n_coll_partners = 1;
+  inp.coll_part[0] = PARA_H2;
+  inp.coll_part_dens[0] = 1e4;
+  inp.geom = SPHERE;
+
+  struct rxi_calc_workspace *work;
+  status = rxi_calc_workspace_malloc (&work, n_enlev);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_data *ref;
+  status = rxi_calc_data_malloc (&ref, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_data *fast;
+  status = rxi_calc_data_malloc (&fast, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+
+  // Densities far above critical ones of all levels, column densities too
+  // low for any line to be thick, and models in between
+  const struct
+  {
+    double dens;
+    double col_dens;
+    FAST_PATH path;
+  }
+  models[] = {
+    { 1e18, 1e15, FP_LTE },
+    { 1e4, 1e8, FP_THIN },
+    { 1e6, 1e10, FP_THIN },
+    { 1e4, 1e15, FP_NONE },
+    { 1e12, 1e15, FP_NONE },
+  };
+  const double temps[] = { 20, 80 };
+  for (size_t t = 0; t < sizeof (temps) / sizeof (temps[0]); ++t)
+    {
+      for (size_t m = 0; m < sizeof (models) / sizeof (models[0]); ++m)
+        {
+          inp.temp_kin = temps[t];
+          inp.coll_part_dens[0] = models[m].dens;
+          inp.col_dens = models[m].col_dens;
+
+          // Fixed-point iteration stops thin models after two relaxed
+          // steps, so Newton gives the converged reference
+          inp.solver.fast_paths = false;
+          inp.solver.method = SM_NEWTON;
+          ref->input = inp;
+          rotor_fill (&rotor, &inp, ref);
+          rxi_calc_data_set_temp_bg (ref);
+          status = rxi_calc_find_rates (ref, work, n_enlev, n_radtr);
+          ASSERT (status == RXI_OK);
+          ASSERT (ref->fast_path == FP_NONE);
+
+          inp.solver.fast_paths = true;
+          fast->input = inp;
+          rotor_fill (&rotor, &inp, fast);
+          rxi_calc_data_set_temp_bg (fast);
+          status = rxi_calc_find_rates (fast, work, n_enlev, n_radtr);
+          ASSERT (status == RXI_OK);
+
+          double diff_max = 0;
+          for (int i = 0; i < n_enlev; ++i)
+            {
+              const double pop = gsl_vector_get (ref->pop, i);
+              if (pop > 1e-8)
+                diff_max = fmax (diff_max,
+                    fabs (gsl_vector_get (fast->pop, i) - pop) / pop);
+            }
+          // Excitation temperatures of lines between empty levels are
+          // ratios of rounding errors
+          // Radiation temperatures take escape probabilities of the lines
+          // as well
+          double tex_max = 0;
+          double trad_max = 0;
+          for (int i = 0; i < n_radtr; ++i)
+            {
+              if (gsl_vector_get (ref->pop, i + 1) <= 1e-8)
+                continue;
+              const double tex = gsl_vector_get (ref->excit_temp, i);
+              tex_max = fmax (tex_max,
+                  fabs (gsl_vector_get (fast->excit_temp, i) - tex) / tex);
+              const double trad = gsl_vector_get (ref->radiation_temp, i);
+              trad_max = fmax (trad_max,
+                  fabs (gsl_vector_get (fast->radiation_temp, i) - trad)
+                  / trad);
+            }
+
+          printf ("Tkin %g, n %g, N %g: path %d, populations %.3e, "
+                  "Tex %.3e, Trad %.3e, iterations %u and %u\n", temps[t],
+                  models[m].dens, models[m].col_dens, fast->fast_path,
+                  diff_max, tex_max, trad_max, ref->numof_iter,
+                  fast->numof_iter);
+          ASSERT (fast->fast_path == models[m].path);
+          ASSERT (diff_max < 1e-6);
+          if (models[m].path != FP_NONE)
+            {
+              ASSERT (fast->numof_iter <= 1);
+              ASSERT (tex_max < 1e-6);
+              ASSERT (trad_max < 1e-6);
+            }
+        }
+    }
+
+  rxi_calc_data_free (ref);
+  rxi_calc_data_free (fast);
+  rxi_calc_workspace_free (work);
+  rotor_free (&rotor);
+
+  return 0;
+}
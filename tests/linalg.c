@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_permutation.h>
+#include <gsl/gsl_linalg.h>
+
+#include "rxi_common.h"
+#include "core/linalg.h"
+#include "utils/debug.h"
+
+int
+main (void)
+{
+  const LU_BACKEND backends[] = { LB_GSL, LB_LAPACK, LB_BLOCKED };
+  // Sizes around the panel width of the blocked LU
+  const size_t sizes[] = { 1, 2, 7, 31, 32, 33, 64, 100, 211 };
+
+  srand (1);
+  for (size_t k = 0; k < sizeof (sizes) / sizeof (sizes[0]); ++k)
+    {
+      const size_t n = sizes[k];
+      gsl_matrix *a = gsl_matrix_alloc (n, n);
+      gsl_matrix *lu = gsl_matrix_alloc (n, n);
+      gsl_permutation *p = gsl_permutation_alloc (n);
+      gsl_vector *b = gsl_vector_alloc (n);
+      gsl_vector *x = gsl_vector_alloc (n);
+      ASSERT (a && lu && p && b && x);
+
+      // Nonsymmetric, needs pivoting, spans orders of magnitude like rates
+      for (size_t i = 0; i < n; ++i)
+        {
+          for (size_t j = 0; j < n; ++j)
+            gsl_matrix_set (a, i, j, (rand () / (double) RAND_MAX - 0.5)
+                                     * pow (10, -(double) (i + 2 * j) / n));
+          gsl_vector_set (b, i, rand () / (double) RAND_MAX);
+        }
+
+      for (size_t m = 0; m < sizeof (backends) / sizeof (backends[0]); ++m)
+        {
+          if (!rxi_linalg_has_backend (backends[m]))
+            continue;
+
+          gsl_matrix_memcpy (lu, a);
+          rxi_linalg_LU_decomp (backends[m], lu, p);
+          gsl_linalg_LU_solve (lu, p, b, x);
+
+          // Relative residual of the solution
+          double res_max = 0;
+          double scale_max = 0;
+          for (size_t i = 0; i < n; ++i)
+            {
+              double res = -gsl_vector_get (b, i);
+              double scale = 0;
+              for (size_t j = 0; j < n; ++j)
+                {
+                  const double ax = gsl_matrix_get (a, i, j)
+                                    * gsl_vector_get (x, j);
+                  res += ax;
+                  scale += fabs (ax);
+                }
+              res_max = fmax (res_max, fabs (res));
+              scale_max = fmax (scale_max, scale);
+            }
+
+          printf ("backend %d, n %3zu: residual %.3e\n", backends[m], n,
+                  res_max / scale_max);
+          ASSERT (res_max <= 1e-12 * scale_max);
+        }
+
+      // Equilibrated system in single precision with iterative refinement;
+      // rows and columns are scaled far apart, as rates of different levels
+      gsl_matrix *as = gsl_matrix_alloc (n, n);
+      gsl_vector *bs = gsl_vector_alloc (n);
+      gsl_vector *r = gsl_vector_alloc (n);
+      gsl_vector *c = gsl_vector_alloc (n);
+      gsl_vector *resid = gsl_vector_alloc (n);
+      float *lu_float = malloc (n * n * sizeof (*lu_float));
+      ASSERT (as && bs && r && c && resid && lu_float);
+
+      for (size_t i = 0; i < n; ++i)
+        {
+          for (size_t j = 0; j < n; ++j)
+            gsl_matrix_set (as, i, j, gsl_matrix_get (a, i, j)
+                                      * pow (10, -30.0 * i / n + 10.0 * j / n));
+          gsl_vector_set (bs, i, gsl_vector_get (b, i)
+                                 * pow (10, -30.0 * i / n));
+        }
+      gsl_matrix_memcpy (lu, as);
+      rxi_linalg_equilibrate (lu, r, c);
+      for (size_t i = 0; i < n; ++i)
+        {
+          double max = 0;
+          for (size_t j = 0; j < n; ++j)
+            {
+              lu_float[i * n + j] = gsl_matrix_get (lu, i, j);
+              max = fmax (max, fabs (gsl_matrix_get (lu, i, j)));
+            }
+          ASSERT (max >= 0.25 && max < 1);
+        }
+      rxi_linalg_LU_decomp_float (n, lu_float, p);
+
+      gsl_vector_mul (bs, r);
+      unsigned int steps = 0;
+      const bool refined = rxi_linalg_refine (lu, lu_float, p, bs, x, resid,
+                                              &steps);
+      ASSERT (refined);
+      gsl_vector_mul (x, c);
+
+      // Unscaled residual relative to the row sums, as above
+      double res_max = 0;
+      for (size_t i = 0; i < n; ++i)
+        {
+          double res = -gsl_vector_get (bs, i) / gsl_vector_get (r, i);
+          double scale = 0;
+          for (size_t j = 0; j < n; ++j)
+            {
+              const double ax = gsl_matrix_get (as, i, j)
+                                * gsl_vector_get (x, j);
+              res += ax;
+              scale += fabs (ax);
+            }
+          res_max = fmax (res_max, fabs (res) / scale);
+        }
+      printf ("mixed precision, n %3zu: %u refinement steps, residual "
+              "%.3e\n", n, steps, res_max);
+      ASSERT (res_max <= 1e-12);
+
+      gsl_matrix_free (as);
+      gsl_vector_free (bs);
+      gsl_vector_free (r);
+      gsl_vector_free (c);
+      gsl_vector_free (resid);
+      free (lu_float);
+
+      gsl_matrix_free (a);
+      gsl_matrix_free (lu);
+      gsl_permutation_free (p);
+      gsl_vector_free (b);
+      gsl_vector_free (x);
+    }
+
+  exit (EXIT_SUCCESS);
+}
@@ -0,0 +1,102 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "utils/debug.h"
+
+#include "rotor.h"
+
+int main (void)
+{
+  const int n_enlev = 30;
+  const int n_radtr = n_enlev - 1;
+
+  RXI_STAT status = RXI_OK;
+  const COLL_PART part = PARA_H2;
+  const double coef = 3e-11;
+  struct rotor rotor;
+  rotor_malloc (&rotor, n_enlev, 1, &part, &coef);
+
+  struct rxi_input_data inp;
+  memset (&inp, 0, sizeof (inp));
+  strcpy (inp.name, "test");
+  inp.temp_bg = 2.73;
+  inp.line_width = 1.0;
+  inp.n_coll_partners = 1;
+  inp.coll_part[0] = PARA_H2;
+  inp.coll_part_dens[0] = 1e4;
+  inp.geom = SPHERE;
+
+  struct rxi_calc_workspace *work;
+  status = rxi_calc_workspace_malloc (&work, n_enlev);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_data *ref;
+  status = rxi_calc_data_malloc (&ref, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_data *lowrank;
+  status = rxi_calc_data_malloc (&lowrank, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+
+  unsigned int updates = 0;
+  // From a few thick low lines, which fit in the update, to many of them,
+  // which make the matrix factorized again
+  const double temps[] = { 20, 80 };
+  const double col_dens[] = { 1e13, 1e15, 1e17 };
+  for (size_t t = 0; t < sizeof (temps) / sizeof (temps[0]); ++t)
+    {
+      for (size_t c = 0; c < sizeof (col_dens) / sizeof (col_dens[0]); ++c)
+        {
+          inp.temp_kin = temps[t];
+          inp.col_dens = col_dens[c];
+
+          inp.solver.linear_solver = LS_LU;
+          ref->input = inp;
+          rotor_fill (&rotor, &inp, ref);
+          rxi_calc_data_set_temp_bg (ref);
+          status = rxi_calc_find_rates (ref, work, n_enlev, n_radtr);
+          ASSERT (status == RXI_OK);
+
+          inp.solver.linear_solver = LS_LOWRANK;
+          lowrank->input = inp;
+          rotor_fill (&rotor, &inp, lowrank);
+          rxi_calc_data_set_temp_bg (lowrank);
+          ASSERT (work->lowrank == NULL || work->lowrank->numof_updates
+                                           == updates);
+          status = rxi_calc_find_rates (lowrank, work, n_enlev, n_radtr);
+          ASSERT (status == RXI_OK);
+          ASSERT (work->lowrank && work->lowrank->numof_factorizations > 0);
+          const unsigned int model_updates
+            = work->lowrank->numof_updates - updates;
+          updates = work->lowrank->numof_updates;
+
+          // Solutions of the linear systems differ by rounding, so the
+          // iteration may stop a step apart
+          double diff_max = 0;
+          for (int i = 0; i < n_enlev; ++i)
+            {
+              const double pop = gsl_vector_get (ref->pop, i);
+              if (pop > 1e-8)
+                diff_max = fmax (diff_max,
+                    fabs (gsl_vector_get (lowrank->pop, i) - pop) / pop);
+            }
+
+          printf ("Tkin %g, N %g: populations %.3e, iterations %u and %u, "
+                  "low-rank solves %u\n", temps[t], col_dens[c], diff_max,
+                  ref->numof_iter, lowrank->numof_iter, model_updates);
+          ASSERT (diff_max < 1e-5);
+        }
+    }
+
+  // Systems of later iterations are solved without a new factorization
+  ASSERT (updates > 0);
+
+  rxi_calc_data_free (ref);
+  rxi_calc_data_free (lowrank);
+  rxi_calc_workspace_free (work);
+  rotor_free (&rotor);
+
+  return 0;
+}
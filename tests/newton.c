@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "utils/debug.h"
+
+#include "rotor.h"
+
+int main (void)
+{
+  const int n_enlev = 30;
+  const int n_radtr = n_enlev - 1;
+
+  RXI_STAT status = RXI_OK;
+  const COLL_PART part = PARA_H2;
+  const double coef = 3e-11;
+  struct rotor rotor;
+  rotor_malloc (&rotor, n_enlev, 1, &part, &coef);
+
+  struct rxi_input_data inp;
+  memset (&inp, 0, sizeof (inp));
+  strcpy (inp.name, "test");
+  inp.temp_bg = 2.73;
+  inp.line_width = 1.0;
+  inp.n_coll_partners = 1;
+  inp.coll_part[0] = PARA_H2;
+  inp.coll_part_dens[0] = 1e4;
+  inp.geom = SPHERE;
+
+  struct rxi_calc_workspace *work;
+  status = rxi_calc_workspace_malloc (&work, n_enlev);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_data *ref;
+  status = rxi_calc_data_malloc (&ref, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_data *newton;
+  status = rxi_calc_data_malloc (&newton, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+
+  // Cold models have most levels almost empty, which must not hold back
+  // Newton steps of the populated ones
+  const double temps[] = { 10, 20, 40 };
+  const double col_dens[] = { 1e16, 1e18 };
+  for (size_t t = 0; t < sizeof (temps) / sizeof (temps[0]); ++t)
+    {
+      for (size_t c = 0; c < sizeof (col_dens) / sizeof (col_dens[0]); ++c)
+        {
+          inp.temp_kin = temps[t];
+          inp.col_dens = col_dens[c];
+
+          inp.solver.method = SM_FIXED_POINT;
+          ref->input = inp;
+          rotor_fill (&rotor, &inp, ref);
+          rxi_calc_data_set_temp_bg (ref);
+          status = rxi_calc_find_rates (ref, work, n_enlev, n_radtr);
+          ASSERT (status == RXI_OK);
+
+          inp.solver.method = SM_NEWTON;
+          newton->input = inp;
+          rotor_fill (&rotor, &inp, newton);
+          rxi_calc_data_set_temp_bg (newton);
+          status = rxi_calc_find_rates (newton, work, n_enlev, n_radtr);
+          ASSERT (status == RXI_OK);
+
+          double tau_max = 0;
+          for (int i = 0; i < n_radtr; ++i)
+            tau_max = fmax (tau_max, gsl_vector_get (newton->tau, i));
+
+          // The fixed-point iteration stops at a tolerance of 1e-7 on the
+          // change of excitation temperatures, which leaves populations
+          // further off than that
+          double diff_max = 0;
+          for (int i = 0; i < n_enlev; ++i)
+            {
+              const double pop = gsl_vector_get (newton->pop, i);
+              if (pop > 1e-6)
+                diff_max = fmax (diff_max,
+                    fabs (gsl_vector_get (ref->pop, i) - pop) / pop);
+            }
+
+          printf ("Tkin %g, N %g: largest tau %.3e, populations %.3e, "
+                  "fallbacks %u\n", temps[t], col_dens[c], tau_max, diff_max,
+                  newton->numof_fallbacks);
+          ASSERT (tau_max > 1);
+          ASSERT (newton->numof_fallbacks == 0);
+          ASSERT (diff_max < 1e-3);
+        }
+    }
+
+  rxi_calc_data_free (ref);
+  rxi_calc_data_free (newton);
+  rxi_calc_workspace_free (work);
+  rotor_free (&rotor);
+
+  return 0;
+}
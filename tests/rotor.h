@@ -0,0 +1,118 @@
+/**
+ * @file tests/rotor.h
+ * @brief Synthetic linear rotor which tests build in memory instead of
+ * reading a molecule from the database.
+ */
+
+#include <stdlib.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "utils/debug.h"
+
+/// @brief Tables of the synthetic molecule in the layout of the database
+/// readers; `cp` is in the order of the partners given to `rotor_malloc()`.
+struct rotor
+{
+  struct rxi_db_molecule_info *info;
+  struct rxi_db_molecule_enlev *enlev;
+  struct rxi_db_molecule_radtr *radtr;
+  struct rxi_db_molecule_coll_part *cp[RXI_COLL_PARTNERS_MAX];
+};
+
+/// @brief Builds a rotor of @p n_enlev levels with CO-like terms and
+/// Einstein coefficients, and lines between neighbouring levels.
+///
+/// Every pair of levels has collisional data at 10, 50 and 100 K; the rate
+/// coefficient of partner `p` for levels `u` > `l` at the `t`-th
+/// temperature is `coefs[p] * (t + 1) / (u - l)`.
+/// @param *rotor -- tables are written here;
+/// @param n_enlev -- number of levels;
+/// @param n_parts -- number of collisional partners;
+/// @param *parts -- partners;
+/// @param *coefs -- scales of rate coefficients of @p parts.
+static void
+rotor_malloc (struct rotor *rotor, const int n_enlev, const int n_parts,
+              const COLL_PART *parts, const double *coefs)
+{
+  const int n_radtr = n_enlev - 1;
+  const int n_trans = n_enlev * (n_enlev - 1) / 2;
+  const int n_temps = 3;
+  const double temps[] = { 10, 50, 100 };
+
+  RXI_STAT status = rxi_db_molecule_info_malloc (&rotor->info);
+  ASSERT (status == RXI_OK);
+  struct rxi_db_molecule_info *info = rotor->info;
+  info->numof_enlev = n_enlev;
+  info->numof_radtr = n_radtr;
+  info->numof_coll_part = n_parts;
+  for (int p = 0; p < n_parts; ++p)
+    {
+      info->coll_part[p] = parts[p];
+      info->numof_coll_trans[p] = n_trans;
+      info->numof_coll_temps[p] = n_temps;
+      for (int t = 0; t < n_temps; ++t)
+        gsl_matrix_set (info->coll_temps, p, t, temps[t]);
+    }
+
+  // Levels up to about 1300 K for 30 of them
+  status = rxi_db_molecule_enlev_malloc (&rotor->enlev, n_enlev);
+  ASSERT (status == RXI_OK);
+  for (int i = 0; i < n_enlev; ++i)
+    {
+      rotor->enlev->level[i] = i + 1;
+      rotor->enlev->term[i] = 1.9225 * i * (i + 1);
+      rotor->enlev->weight[i] = 2 * i + 1;
+    }
+
+  status = rxi_db_molecule_radtr_malloc (&rotor->radtr, n_radtr);
+  ASSERT (status == RXI_OK);
+  for (int i = 0; i < n_radtr; ++i)
+    {
+      rotor->radtr->up[i] = i + 2;
+      rotor->radtr->low[i] = i + 1;
+      rotor->radtr->einst[i] = 7.2e-8 * (i + 1) * (i + 1) * (i + 1);
+      rotor->radtr->freq[i] = 115.27 * (i + 1);
+    }
+
+  for (int p = 0; p < n_parts; ++p)
+    {
+      status = rxi_db_molecule_coll_part_malloc (&rotor->cp[p], n_trans,
+                                                 n_temps);
+      ASSERT (status == RXI_OK);
+      struct rxi_db_molecule_coll_part *cp = rotor->cp[p];
+      int k = 0;
+      for (int u = 2; u <= n_enlev; ++u)
+        {
+          for (int l = 1; l < u; ++l)
+            {
+              cp->up[k] = u;
+              cp->low[k] = l;
+              for (int t = 0; t < n_temps; ++t)
+                gsl_matrix_set (cp->coll_rates, k, t,
+                                coefs[p] * (t + 1) / (u - l));
+              ++k;
+            }
+        }
+    }
+}
+
+/// @brief `rxi_calc_data_fill()` from the tables of @p rotor for @p inp.
+static void
+rotor_fill (struct rotor *rotor, const struct rxi_input_data *inp,
+            struct rxi_calc_data *data)
+{
+  rxi_calc_data_fill (inp, rotor->info, rotor->enlev, rotor->radtr,
+                      rotor->cp, data);
+}
+
+/// @brief Frees tables built by `rotor_malloc()`.
+static void
+rotor_free (struct rotor *rotor)
+{
+  for (int p = 0; p < rotor->info->numof_coll_part; ++p)
+    rxi_db_molecule_coll_part_free (rotor->cp[p]);
+  rxi_db_molecule_radtr_free (rotor->radtr);
+  rxi_db_molecule_enlev_free (rotor->enlev);
+  rxi_db_molecule_info_free (rotor->info);
+}
@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "rxi_common.h"
+#include "core/calculation.h"
+#include "utils/debug.h"
+
+#include "rotor.h"
+
+int main (void)
+{
+  const int n_enlev = 30;
+  const int n_radtr = n_enlev - 1;
+
+  RXI_STAT status = RXI_OK;
+  const COLL_PART part = PARA_H2;
+  const double coef = 3e-11;
+  struct rotor rotor;
+  rotor_malloc (&rotor, n_enlev, 1, &part, &coef);
+
+  struct rxi_input_data inp;
+  memset (&inp, 0, sizeof (inp));
+  strcpy (inp.name, "test");
+  inp.temp_bg = 2.73;
+  inp.line_width = 1.0;
+  inp.n_coll_partners = 1;
+  inp.coll_part[0] = PARA_H2;
+  inp.geom = SPHERE;
+  // Newton converges tightly, so differences come from truncation only
+  inp.solver.method = SM_NEWTON;
+
+  struct rxi_calc_workspace *work;
+  status = rxi_calc_workspace_malloc (&work, n_enlev);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_data *full;
+  status = rxi_calc_data_malloc (&full, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+  struct rxi_calc_data *truncated;
+  status = rxi_calc_data_malloc (&truncated, n_enlev, n_radtr);
+  ASSERT (status == RXI_OK);
+
+  const double temps[] = { 10, 15, 20, 30, 80 };
+  const double col_dens[] = { 1e12, 1e16 };
+  for (size_t t = 0; t < sizeof (temps) / sizeof (temps[0]); ++t)
+    {
+      for (size_t c = 0; c < sizeof (col_dens) / sizeof (col_dens[0]); ++c)
+        {
+          inp.temp_kin = temps[t];
+          inp.col_dens = col_dens[c];
+          inp.coll_part_dens[0] = 1e4;
+
+          inp.solver.truncate = 0;
+          full->input = inp;
+          rotor_fill (&rotor, &inp, full);
+          rxi_calc_data_set_temp_bg (full);
+          status = rxi_calc_find_rates (full, work, n_enlev, n_radtr);
+          ASSERT (status == RXI_OK);
+          // Populations after a fallback are only as good as the tolerance
+          // of the fixed-point iteration, which is no reference
+          ASSERT (full->numof_fallbacks == 0);
+
+          // A cut this low is widened a few times before it is accepted
+          inp.solver.truncate = 2;
+          truncated->input = inp;
+          rotor_fill (&rotor, &inp, truncated);
+          rxi_calc_data_set_temp_bg (truncated);
+          status = rxi_calc_find_rates (truncated, work, n_enlev, n_radtr);
+          ASSERT (status == RXI_OK);
+          ASSERT (truncated->numof_fallbacks == 0);
+
+          double diff_max = 0;
+          for (int i = 0; i < n_enlev; ++i)
+            {
+              const double pop = gsl_vector_get (full->pop, i);
+              if (pop > 1e-6)
+                diff_max = fmax (diff_max,
+                    fabs (gsl_vector_get (truncated->pop, i) - pop) / pop);
+            }
+          double tex_diff_max = 0;
+          for (int i = 0; i < n_radtr; ++i)
+            {
+              const int up = rotor.radtr->up[i] - 1;
+              if (gsl_vector_get (full->pop, up) < 1e-6)
+                continue;
+              const double tex = gsl_vector_get (full->excit_temp, i);
+              tex_diff_max = fmax (tex_diff_max,
+                  fabs (gsl_vector_get (truncated->excit_temp, i) - tex)
+                  / tex);
+            }
+
+          printf ("Tkin %g, N %g: populations %.3e, Tex %.3e\n", temps[t],
+                  col_dens[c], diff_max, tex_diff_max);
+          ASSERT (diff_max < 1e-6);
+          ASSERT (tex_diff_max < 1e-6);
+        }
+    }
+
+  rxi_calc_data_free (full);
+  rxi_calc_data_free (truncated);
+  rxi_calc_workspace_free (work);
+  rotor_free (&rotor);
+
+  return 0;
+}